@@ -0,0 +1,155 @@
+/*
+ * SPDX-FileCopyrightText: Hanspeter Portner <dev@open-music-kontrollers.ch>
+ * SPDX-License-Identifier: Artistic-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <patchmatrix/patchmatrix_gain.h>
+
+#define NSAMPLES 0x100000
+#define NROUNDS 32
+#define LUT_ERROR 1e-6 // relative, float rounding of exp10f
+
+static int32_t mBFS [NSAMPLES];
+static float x [NSAMPLES];
+static volatile float sink; // keeps timed loops from being optimized away
+
+static double
+_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+// worst absolute error in dB, over every 16th float of the documented range
+static double
+_check_dBFS(void)
+{
+	union {
+		float f;
+		uint32_t i;
+	} v = { .f = 0x1p-24f };
+	const float end = 0x1p12f;
+	double worst = 0.0;
+
+	for( ; v.f <= end; v.i += 16)
+	{
+		const double err = fabs(_gain_to_dBFS(v.f) - 20.0*log10(v.f));
+
+		if(err > worst)
+			worst = err;
+	}
+
+	return worst;
+}
+
+// worst relative error of the table
+static double
+_check_lut(void)
+{
+	double worst = 0.0;
+
+	if(_gain_from_mBFS(GAIN_MIN) != 0.f)
+		return INFINITY;
+
+	for(int32_t m = GAIN_MIN + 1; m <= GAIN_MAX; m++)
+	{
+		const double ref = pow(10.0, m / 2000.0);
+		const double err = fabs(_gain_from_mBFS(m) - ref) / ref;
+
+		if(err > worst)
+			worst = err;
+	}
+
+	return worst;
+}
+
+// ns per conversion, best of all rounds
+#define BENCH(BEST, EXPR) \
+do { \
+	BEST = INFINITY; \
+	for(unsigned r = 0; r < NROUNDS; r++) \
+	{ \
+		float acc = 0.f; \
+		const double t0 = _now(); \
+		for(unsigned k = 0; k < NSAMPLES; k++) \
+			acc += (EXPR); \
+		const double dt = (_now() - t0) / NSAMPLES; \
+		sink = acc; \
+		if(dt < BEST) \
+			BEST = dt; \
+	} \
+} while(0)
+
+static void
+_bench(void)
+{
+	srand(1);
+	for(unsigned k = 0; k < NSAMPLES; k++)
+	{
+		mBFS[k] = GAIN_MIN + rand() % (GAIN_MAX - GAIN_MIN + 1);
+		x[k] = _gain_from_mBFS(mBFS[k]) + 1e-7f;
+	}
+
+	double t_lut, t_exp10f, t_approx, t_log10f;
+	BENCH(t_lut, _gain_from_mBFS(mBFS[k]));
+	BENCH(t_exp10f, exp10f(mBFS[k] / 2000.f));
+	BENCH(t_approx, _gain_to_dBFS(x[k]));
+	BENCH(t_log10f, 20.f*log10f(x[k]));
+
+	printf("mBFS to linear: table %.2f ns, exp10f %.2f ns\n", t_lut, t_exp10f);
+	printf("linear to dBFS: approximation %.2f ns, log10f %.2f ns\n", t_approx, t_log10f);
+}
+
+int
+main(int argc, char **argv)
+{
+	bool check_only = false;
+
+	int c;
+	while((c = getopt(argc, argv, "hc")) != -1)
+	{
+		switch(c)
+		{
+			case 'h':
+				fprintf(stderr,
+					"USAGE\n"
+					"   %s [OPTIONS]\n"
+					"\n"
+					"OPTIONS\n"
+					"   [-h]                 print usage information\n"
+					"   [-c]                 check accuracy only, skip timing\n\n"
+					, argv[0]);
+				return 0;
+			case 'c':
+				check_only = true;
+				break;
+			default:
+				return -1;
+		}
+	}
+
+	_gain_init();
+
+	const double err_dBFS = _check_dBFS();
+	const double err_lut = _check_lut();
+
+	printf("linear to dBFS: %g dB worst error, bound %g dB\n", err_dBFS, GAIN_DBFS_ERROR);
+	printf("mBFS to linear: %g worst relative error, bound %g\n", err_lut, LUT_ERROR);
+
+	if( (err_dBFS > GAIN_DBFS_ERROR) || (err_lut > LUT_ERROR) )
+		return EXIT_FAILURE;
+
+	if(!check_only)
+		_bench();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,251 @@
+/*
+ * SPDX-FileCopyrightText: Hanspeter Portner <dev@open-music-kontrollers.ch>
+ * SPDX-License-Identifier: Artistic-2.0
+ */
+
+#include <time.h>
+#include <sys/eventfd.h>
+
+#include <patchmatrix/patchmatrix.h>
+#include <patchmatrix/patchmatrix_jack.h>
+
+#ifdef JACK_HAS_METADATA_API
+#	include <jack/metadata.h>
+#endif
+
+#define CLIENT_MAX 256
+#define ROUND_MAX 100
+#define EXIT_SKIP 77 // as understood by meson
+
+static app_t app;
+static jack_client_t *clients [CLIENT_MAX];
+
+static double
+_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec*1e3 + ts.tv_nsec*1e-6;
+}
+
+static int
+_cmp(const void *a, const void *b)
+{
+	const double *x = a;
+	const double *y = b;
+
+	return (*x > *y) - (*x < *y);
+}
+
+// clients with a chain of connected ports and a pretty name per port
+static unsigned
+_fixture_add(const char *server_name, unsigned nclients, unsigned nports)
+{
+	jack_options_t opts = JackNullOption | JackNoStartServer;
+	if(server_name)
+		opts |= JackServerName;
+
+	jack_port_t *prev = NULL;
+	unsigned nregistered = 0;
+
+	for(unsigned c = 0; c < nclients; c++)
+	{
+		char name [32];
+		snprintf(name, sizeof(name), "bench_%03u", c);
+
+		jack_client_t *client = jack_client_open(name, opts, NULL, server_name);
+		if(!client)
+			break;
+
+		clients[c] = client;
+
+		jack_port_t *last = NULL;
+
+		for(unsigned p = 0; p < nports; p++)
+		{
+			const bool is_sink = p % 2;
+
+			snprintf(name, sizeof(name), is_sink ? "sink_%03u" : "source_%03u", p/2);
+			jack_port_t *port = jack_port_register(client, name, JACK_DEFAULT_AUDIO_TYPE,
+				is_sink ? JackPortIsInput : JackPortIsOutput, 0);
+			if(!port)
+				continue;
+
+			nregistered++;
+
+#ifdef JACK_HAS_METADATA_API
+			jack_uuid_t uuid = jack_port_uuid(port);
+			snprintf(name, sizeof(name), "Bench %u/%u", c, p);
+			jack_set_property(client, uuid, JACK_METADATA_PRETTY_NAME, name, "text/plain");
+#endif
+
+			if(!is_sink)
+				last = port;
+		}
+
+		jack_activate(client);
+
+		if(prev) // connect last source of previous client to first sink
+		{
+			char sink_name [64];
+			snprintf(sink_name, sizeof(sink_name), "%s:sink_000", jack_get_client_name(client));
+			jack_connect(client, jack_port_name(prev), sink_name);
+		}
+
+		prev = last;
+	}
+
+	return nregistered;
+}
+
+static void
+_fixture_free(void)
+{
+	for(unsigned c = 0; c < CLIENT_MAX; c++)
+	{
+		if(!clients[c])
+			continue;
+
+#ifdef JACK_HAS_METADATA_API
+		const char **port_names = jack_get_ports(clients[c], jack_get_client_name(clients[c]), NULL, 0);
+		if(port_names)
+		{
+			for(const char **itr = port_names; *itr; itr++)
+			{
+				jack_port_t *port = jack_port_by_name(clients[c], *itr);
+
+				if(port)
+					jack_remove_properties(clients[c], jack_port_uuid(port));
+			}
+			jack_free(port_names);
+		}
+#endif
+
+		jack_client_close(clients[c]);
+		clients[c] = NULL;
+	}
+}
+
+static void
+_drain(app_t *app)
+{
+	size_t len;
+
+	while(varchunk_read_request(app->from_jack, &len))
+		varchunk_read_advance(app->from_jack);
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned nclients = 64;
+	unsigned nports = 32;
+	unsigned nrounds = 10;
+	int ret = EXIT_FAILURE;
+
+	app.scale = 1.f;
+	app.nxt_source = 30;
+	app.nxt_sink = 720/2;
+	app.nxt_default = 30;
+	app.server_name = NULL;
+	app.wake = -1;
+
+	int c;
+	while((c = getopt(argc, argv, "hn:c:p:r:")) != -1)
+	{
+		switch(c)
+		{
+			case 'h':
+				fprintf(stderr,
+					"USAGE\n"
+					"   %s [OPTIONS]\n"
+					"\n"
+					"OPTIONS\n"
+					"   [-h]                 print usage information\n"
+					"   [-n] server-name     connect to named JACK daemon\n"
+					"   [-c] client-num      number of fixture clients (1-%u)\n"
+					"   [-p] port-num        number of ports per fixture client\n"
+					"   [-r] round-num       number of timed populations (1-%u)\n\n"
+					, argv[0], CLIENT_MAX, ROUND_MAX);
+				return 0;
+			case 'n':
+				app.server_name = optarg;
+				break;
+			case 'c':
+				nclients = atoi(optarg);
+				if(nclients < 1)
+					nclients = 1;
+				else if(nclients > CLIENT_MAX)
+					nclients = CLIENT_MAX;
+				break;
+			case 'p':
+				nports = atoi(optarg);
+				if(nports < 1)
+					nports = 1;
+				break;
+			case 'r':
+				nrounds = atoi(optarg);
+				if(nrounds < 1)
+					nrounds = 1;
+				else if(nrounds > ROUND_MAX)
+					nrounds = ROUND_MAX;
+				break;
+			default:
+				return -1;
+		}
+	}
+
+	const unsigned nregistered = _fixture_add(app.server_name, nclients, nports);
+	if(nregistered == 0)
+	{
+		fprintf(stderr, "No JACK server to run against, skipping.\n");
+		_fixture_free();
+		return EXIT_SKIP;
+	}
+
+	if(!(app.from_jack = varchunk_new(0x100000, true)))
+		goto cleanup;
+
+	if((app.wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1)
+		goto cleanup;
+
+	double ms [ROUND_MAX];
+	for(unsigned r = 0; r < nrounds; r++)
+	{
+		const double t0 = _now();
+
+		// open, activate and populate, just like at startup
+		if(_jack_init(&app))
+			goto cleanup;
+
+		ms[r] = _now() - t0;
+
+		_jack_deinit(&app);
+		_drain(&app);
+	}
+
+	qsort(ms, nrounds, sizeof(double), _cmp);
+
+	double sum = 0.0;
+	for(unsigned r = 0; r < nrounds; r++)
+		sum += ms[r];
+
+	printf("populate %u ports: min %.3f ms, median %.3f ms, mean %.3f ms, max %.3f ms\n",
+		nregistered, ms[0], ms[nrounds/2], sum / nrounds, ms[nrounds - 1]);
+
+	ret = EXIT_SUCCESS;
+
+cleanup:
+	_jack_deinit(&app);
+
+	if(app.wake != -1)
+		close(app.wake);
+
+	if(app.from_jack)
+		varchunk_free(app.from_jack);
+
+	_fixture_free();
+
+	return ret;
+}
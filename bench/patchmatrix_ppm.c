@@ -0,0 +1,68 @@
+/*
+ * SPDX-FileCopyrightText: Hanspeter Portner <dev@open-music-kontrollers.ch>
+ * SPDX-License-Identifier: Artistic-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <patchmatrix/patchmatrix_dsp.h>
+
+#define SAMPLE_RATE 48000
+#define NSAMPLES 0x8000 // multiple of every period
+#define ATTACK 0.005f // s, as in monitor's PPM mode
+#define BURST_READING -1.f // dB, IEC 60268-10 type I for 10 ms bursts
+#define BURST_ERROR 0.5f // dB
+#define STEADY_ERROR 0.1f // dB
+#define PERIOD_ERROR 1e-4f // dB
+
+static float x [NSAMPLES];
+
+// highest reading of a full-scale 1 kHz burst of given length, metered per period
+static float
+_burst(const dsp_t *dsp, float attack, uint32_t nburst, uint32_t period)
+{
+	dsp_meter_t meter;
+	memset(&meter, 0x0, sizeof(meter));
+
+	for(uint32_t k = 0; k < NSAMPLES; k++)
+		x[k] = (k < nburst) ? sinf(2.f * M_PI * 1000.f * k / SAMPLE_RATE) : 0.f;
+
+	for(uint32_t k = 0; k < NSAMPLES; k += period)
+		_dsp_meter(dsp, &x[k], period, &meter, attack);
+
+	return 20.f * log10f(meter.peak);
+}
+
+int
+main(void)
+{
+	dsp_t dsp;
+	_dsp_init(&dsp);
+
+	const float attack = _dsp_meter_attack(ATTACK, SAMPLE_RATE);
+	const float steady = _burst(&dsp, attack, NSAMPLES, 1024);
+	bool failed = fabsf(steady) > STEADY_ERROR;
+
+	printf("%s: steady state reads %.2f dB\n", dsp.isa, steady);
+
+	const float ref = _burst(&dsp, attack, SAMPLE_RATE / 100, 1024);
+
+	for(uint32_t period = 16; period <= 2048; period *= 2)
+	{
+		const float burst = _burst(&dsp, attack, SAMPLE_RATE / 100, period);
+
+		printf("%s: 10 ms burst reads %.2f dB at %u frames per period\n",
+			dsp.isa, burst, period);
+
+		if(  (fabsf(burst - BURST_READING) > BURST_ERROR)
+			|| (fabsf(burst - ref) > PERIOD_ERROR) )
+		{
+			failed = true;
+		}
+	}
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -7,6 +7,10 @@
 #define _PATCHMATRIX_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <unistd.h>
 #include <math.h>
@@ -15,6 +19,8 @@
 #include <signal.h>
 #include <string.h>
 #include <semaphore.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <jack/jack.h>
 #include <jack/midiport.h>
@@ -29,8 +35,27 @@
 
 #include <varchunk/varchunk.h>
 
-#define NK_PUGL_API
-#include <nk_pugl/nk_pugl.h>
+#ifdef PATCHMATRIX_HEADLESS
+// canvas geometry only, nothing gets drawn without nk_pugl
+struct nk_vec2 {
+	float x, y;
+};
+
+struct nk_rect {
+	float x, y, w, h;
+};
+
+static inline struct nk_vec2
+nk_vec2(float x, float y)
+{
+	const struct nk_vec2 vec = { .x = x, .y = y };
+
+	return vec;
+}
+#else
+#	define NK_PUGL_API
+#	include <nk_pugl/nk_pugl.h>
+#endif
 
 #define PATCHMATRIX_URI              "http://open-music-kontrollers.ch/patchmatrix"
 #define PATCHMATRIX_PREFIX           PATCHMATRIX_URI"#"
@@ -48,18 +73,37 @@
 
 #define PATCHMATRIX_MIXER            "patchmatrix_mixer"
 #define PATCHMATRIX_MONITOR          "patchmatrix_monitor"
+#define PATCHMATRIX_ENGINE           "patchmatrix_engine"
 
 #define PATCHMATRIX_MIXER_ID          "/"PATCHMATRIX_MIXER
 #define PATCHMATRIX_MONITOR_ID        "/"PATCHMATRIX_MONITOR
+#define PATCHMATRIX_ENGINE_ID         "/"PATCHMATRIX_ENGINE
 
-#define PORT_MAX 128
+#define PORT_MAX 512
+#define SHM_VERSION 6 // bump whenever the shared memory layout changes
+#define SHM_ALIGN 16 // gains per cache line
+#define MIXER_RING_SIZE 0x1000 // command ring body size, power of 2
+#define ENGINE_RING_SIZE 0x1000 // command ring body size, power of 2
+#define ENGINE_SHM_NAME_SIZE 128
+#define SPATIAL_BUCKETS 64 // hashed grid cells, one bit each in a 64-bit mask
+#define SPATIAL_CELL 256.f // grid cell size in canvas units
 
 typedef struct _hash_t hash_t;
+typedef struct _index_slot_t index_slot_t;
+typedef struct _index_t index_t;
+typedef struct _spatial_node_t spatial_node_t;
+typedef struct _spatial_t spatial_t;
 typedef struct _port_conn_t port_conn_t;
 typedef struct _client_conn_t client_conn_t;
 typedef struct _port_t port_t;
+typedef struct _shm_hdr_t shm_hdr_t;
+typedef struct _mixer_cmd_t mixer_cmd_t;
 typedef struct _mixer_shm_t mixer_shm_t;
+typedef struct _monitor_level_t monitor_level_t;
 typedef struct _monitor_shm_t monitor_shm_t;
+typedef struct _engine_cmd_t engine_cmd_t;
+typedef struct _engine_shm_t engine_shm_t;
+typedef struct _zygote_req_t zygote_req_t;
 typedef struct _client_t client_t;
 typedef struct _app_t app_t;
 typedef struct _event_t event_t;
@@ -92,6 +136,12 @@ typedef enum _port_type_t {
 #endif
 } port_type_t;
 
+#ifdef JACK_HAS_METADATA_API
+#	define TYPE_BITS 4
+#else
+#	define TYPE_BITS 2
+#endif
+
 typedef enum _port_designation_t {
 	DESIGNATION_NONE	= 0,
 	DESIGNATION_LEFT,
@@ -110,14 +160,70 @@ typedef enum _port_designation_t {
 	DESIGNATION_MAX
 } port_designation_t;
 
+typedef enum _client_dirty_t {
+	DIRTY_NONE  = (0 << 0),
+	DIRTY_SORT  = (1 << 0) // port order
+} client_dirty_t;
+
+typedef enum _monitor_mode_t {
+	MONITOR_MODE_PEAK, // sample peak, true-peak and RMS with fast release
+	MONITOR_MODE_PPM, // same with IEC 60268-10 type I release
+	MONITOR_MODE_LUFS, // EBU R128 loudness
+
+	MONITOR_MODE_MAX
+} monitor_mode_t;
+
+typedef enum _mixer_cmd_type_t {
+	MIXER_CMD_GAIN, // fade a single cell to a new gain
+	MIXER_CMD_RAMP // set fade time of subsequent gain changes
+} mixer_cmd_type_t;
+
+typedef enum _engine_cmd_type_t {
+	ENGINE_CMD_MIXER, // host a new mixer
+	ENGINE_CMD_MONITOR // host a new monitor
+} engine_cmd_type_t;
+
 struct _hash_t {
 	void **nodes;
 	unsigned size;
+	unsigned capacity;
+};
+
+struct _index_slot_t {
+	uint64_t key;
+	void *node;
+};
+
+struct _index_t {
+	index_slot_t *slots;
+	unsigned size; // number of slots, power of two
+	unsigned used; // number of live nodes
+	unsigned dirty; // number of live nodes plus tombstones
+};
+
+struct _spatial_node_t {
+	struct nk_rect bounds; // canvas coordinates, unscrolled
+	client_t *client;
+	client_conn_t *client_conn;
+	unsigned stamp; // last query that returned this node
+};
+
+struct _spatial_t {
+	spatial_node_t *nodes; // clients first, then connections, in drawing order
+	unsigned size;
+	unsigned capacity;
+	hash_t buckets [SPATIAL_BUCKETS];
+	hash_t pinned; // nodes being dragged, drawn regardless of visibility
+	hash_t result;
+	hash_t visible; // clients drawn in last frame
+	unsigned stamp;
+	bool dirty;
 };
 
 struct _port_conn_t {
 	port_t *source_port;
 	port_t *sink_port;
+	client_conn_t *client_conn;
 };
 
 struct _client_conn_t {
@@ -125,24 +231,97 @@ struct _client_conn_t {
 	client_t *sink_client;
 	hash_t conns;
 	port_type_t type;
+	unsigned type_refs [TYPE_BITS]; // number of port connections per type
+
+	// connection matrix, one row per source port, one bit per sink port
+	uint32_t *bitmap;
+	unsigned rows;
+	unsigned stride; // words per row
+	unsigned capacity; // words allocated
+	bool stale;
 
 	struct nk_vec2 pos;
 	bool moving;
 };
 
+struct _shm_hdr_t {
+	atomic_uint version; // published last, once the layout is initialized
+	size_t size; // total size of the mapping in bytes
+};
+
+struct _mixer_cmd_t {
+	mixer_cmd_type_t type;
+	union {
+		struct {
+			uint32_t source;
+			uint32_t sink;
+			int32_t mBFS;
+		} gain;
+		struct {
+			uint32_t ms;
+		} ramp;
+	};
+};
+
 struct _mixer_shm_t {
-	sem_t done;
-	atomic_bool closing;
+	shm_hdr_t hdr;
 	unsigned nsinks;
 	unsigned nsources;
-	atomic_int jgains [PORT_MAX][PORT_MAX];
+	unsigned stride; // gains per source row, nsinks plus offset padded to whole cache lines
+	port_type_t type;
+	size_t ring; // offset of command ring (varchunk_t) from start of mapping
+	sem_t done;
+	atomic_bool closing;
+	atomic_bool locked; // held by a UI while it writes to the command ring
+	atomic_bool resync; // commands were dropped, rederive gains from jgains
+	atomic_uint seq; // bumped whenever gains change
+	_Alignas(64) atomic_int jgains []; // nsources rows of stride gains, CV offset at nsinks
+};
+
+struct _monitor_level_t {
+	atomic_int peak; // sample peak in mBFS, or 100*velocity for MIDI
+	atomic_int rms; // mBFS
+	atomic_int true_peak; // 4x oversampled peak in mBFS
+	atomic_int hold; // held true-peak in mBFS, maximum since start for LUFS
+	atomic_int momentary; // 400 ms loudness in 100*LUFS
+	atomic_int short_term; // 3 s loudness in 100*LUFS
+	atomic_int integrated; // gated loudness since start in 100*LUFS
+	atomic_int min; // CV minimum in thousandths
+	atomic_int max; // CV maximum in thousandths
+	atomic_int mean; // CV mean in thousandths
 };
 
 struct _monitor_shm_t {
+	shm_hdr_t hdr;
+	unsigned nsinks;
+	monitor_mode_t mode;
 	sem_t done;
 	atomic_bool closing;
-	unsigned nsinks;
-	atomic_int jgains [PORT_MAX];
+	atomic_uint seq; // bumped whenever levels change
+	monitor_level_t levels []; // one per sink
+};
+
+struct _engine_cmd_t {
+	engine_cmd_type_t type;
+	port_type_t port_type;
+	uint32_t nsinks;
+	uint32_t nsources; // mixer only
+	monitor_mode_t mode; // monitor only
+};
+
+struct _engine_shm_t {
+	shm_hdr_t hdr;
+	size_t ring; // offset of command ring (varchunk_t) from start of mapping
+	sem_t wake; // posted by UI after pushing commands
+	atomic_bool locked; // held by a UI while it writes to the command ring
+	pid_t pid; // of engine, to tell a running one from a crashed one
+};
+
+// single datagram sent by UI to mixer spawn server
+struct _zygote_req_t {
+	port_type_t port_type;
+	uint32_t nsinks;
+	uint32_t nsources;
 };
 
 struct _port_t {
@@ -153,8 +332,11 @@ struct _port_t {
 	char *short_name;
 	char *pretty_name;
 	int order;
+	unsigned index; // position within client sources or sinks
+	bool is_input;
 	port_type_t type;
 	port_designation_t designation;
+	hash_t conns;
 };
 
 struct node_linking {
@@ -186,8 +368,18 @@ struct _client_t {
 
 	mixer_shm_t *mixer_shm;
 	monitor_shm_t *monitor_shm;
+	bool hosted; // unit of engine, without JACK client of its own
 	port_type_t sink_type;
 	port_type_t source_type;
+	unsigned sink_type_refs [TYPE_BITS]; // number of sink ports per type
+	unsigned source_type_refs [TYPE_BITS]; // number of source ports per type
+
+	client_dirty_t dirty;
+
+	struct {
+		unsigned seq; // shm sequence number as of last frame
+		bool valid; // mixer or monitor was drawn in last frame
+	} drawn;
 };
 
 struct _event_t {
@@ -262,8 +454,15 @@ struct _app_t {
 	varchunk_t *from_jack;
 
 	const char *server_name;
+	bool engine; // host mixers and monitors in a shared engine client
+	bool zygote; // spawn mixers via pre-forked spawn server
 
+#ifdef PATCHMATRIX_HEADLESS
+	int wake; // eventfd, signaled by JACK callbacks
+	int ctrl; // listening control socket
+#else
 	nk_pugl_window_t win;
+#endif
 
 	float scale;
 	float dy;
@@ -273,9 +472,33 @@ struct _app_t {
 	float nxt_default;
 	hash_t clients;
 	hash_t conns;
+	hash_t dirty_clients;
+
+	index_t client_names;
+#ifdef JACK_HAS_METADATA_API
+	index_t client_uuids;
+#endif
+	index_t port_names;
+	index_t port_bodies;
+#ifdef JACK_HAS_METADATA_API
+	index_t port_uuids;
+#endif
+	index_t client_conns;
+
+	spatial_t spatial;
+
+#ifdef JACK_HAS_METADATA_API
+	struct {
+		bool active;
+		jack_description_t *descs;
+		int ndescs;
+		index_t subjects;
+	} snapshot;
+#endif
 
 	struct node_editor nodedit;
 
+#ifndef PATCHMATRIX_HEADLESS
 	struct {
 		struct nk_image audio;
 		struct nk_image midi;
@@ -284,9 +507,11 @@ struct _app_t {
 		struct nk_image osc;
 #endif
 	} icons;
+#endif
 
 	atomic_bool done;
 	bool animating;
+	unsigned refresh_rate; // maximal meter refresh rate in Hz
 	struct nk_rect contextbounds;
 };
 
@@ -308,75 +533,77 @@ _hash_size(hash_t *hash)
 	return hash->size;
 }
 
+static void
+_hash_free(hash_t *hash)
+{
+	free(hash->nodes);
+	hash->nodes = NULL;
+	hash->size = 0;
+	hash->capacity = 0;
+}
+
+static void
+_hash_clear(hash_t *hash)
+{
+	hash->size = 0; // keep nodes allocated for reuse
+}
+
 static void
 _hash_add(hash_t *hash, void *node)
 {
-	hash->nodes = realloc(hash->nodes, (hash->size + 1)*sizeof(void *));
-	if(hash->nodes)
+	if(hash->size == hash->capacity) // grow geometrically
 	{
-		hash->nodes[hash->size] = node;
-		hash->size++;
+		const unsigned capacity = hash->capacity ? hash->capacity * 2 : 8;
+		void **nodes = realloc(hash->nodes, capacity*sizeof(void *));
+		if(!nodes)
+			return;
+
+		hash->nodes = nodes;
+		hash->capacity = capacity;
 	}
+
+	hash->nodes[hash->size] = node;
+	hash->size++;
 }
 
 static void
 _hash_remove(hash_t *hash, void *node)
 {
-	void **nodes = NULL;
-	size_t size = 0;
-
 	HASH_FOREACH(hash, node_itr)
 	{
-		void *node_ptr = *node_itr;
-
-		if(node_ptr != node)
+		if(*node_itr == node)
 		{
-			nodes = realloc(nodes, (size + 1)*sizeof(void *));
-			if(nodes)
-			{
-				nodes[size] = node_ptr;
-				size++;
-			}
+			const size_t tail = hash->size - (node_itr - hash->nodes) - 1;
+
+			memmove(node_itr, node_itr + 1, tail*sizeof(void *));
+			hash->size--;
+
+			if(!hash->size)
+				_hash_free(hash);
+
+			return;
 		}
 	}
-
-	free(hash->nodes);
-	hash->nodes = nodes;
-	hash->size = size;
 }
 
 static void
 _hash_remove_cb(hash_t *hash, bool (*cb)(void *node, void *data), void *data)
 {
-	void **nodes = NULL;
-	size_t size = 0;
+	unsigned size = 0;
 
+	// compact in-place, preserving order of retained nodes
 	HASH_FOREACH(hash, node_itr)
 	{
 		void *node_ptr = *node_itr;
 
 		if(cb(node_ptr, data))
-		{
-			nodes = realloc(nodes, (size + 1)*sizeof(void *));
-			if(nodes)
-			{
-				nodes[size] = node_ptr;
-				size++;
-			}
-		}
+			hash->nodes[size++] = node_ptr;
 	}
 
-	free(hash->nodes);
-	hash->nodes = nodes;
 	hash->size = size;
-}
 
-static void
-_hash_free(hash_t *hash)
-{
-	free(hash->nodes);
-	hash->nodes = NULL;
-	hash->size = 0;
+	if(!hash->size)
+		_hash_free(hash);
 }
 
 static void *
@@ -410,6 +637,316 @@ _hash_sort_r(hash_t *hash, int (*cmp)(const void *a, const void *b, void *data),
 		qsort_r(hash->nodes, hash->size, sizeof(void *), cmp, data);
 }
 
+#define INDEX_TOMBSTONE ((void *)(uintptr_t)1) // same in every translation unit, never a node
+
+#define INDEX_FOREACH(index, key, itr) \
+	for(index_slot_t *(itr) = _index_first((index), (key)); \
+		(itr); \
+		(itr) = _index_next((index), (key), (itr)))
+
+static inline uint64_t
+_index_mix(uint64_t key)
+{
+	// splitmix64 finalizer
+	key ^= key >> 30;
+	key *= UINT64_C(0xbf58476d1ce4e5b9);
+	key ^= key >> 27;
+	key *= UINT64_C(0x94d049bb133111eb);
+	key ^= key >> 31;
+
+	return key;
+}
+
+static inline uint64_t
+_index_key_str(const char *str)
+{
+	// FNV-1a
+	uint64_t key = UINT64_C(0xcbf29ce484222325);
+
+	for(const uint8_t *ptr = (const uint8_t *)str; *ptr; ptr++)
+	{
+		key ^= *ptr;
+		key *= UINT64_C(0x100000001b3);
+	}
+
+	return key;
+}
+
+static inline uint64_t
+_index_key_ptr(const void *ptr)
+{
+	return _index_mix((uintptr_t)ptr);
+}
+
+static inline uint64_t
+_index_key_ptr2(const void *ptr1, const void *ptr2)
+{
+	return _index_mix(_index_mix((uintptr_t)ptr1) ^ (uintptr_t)ptr2);
+}
+
+static inline uint64_t
+_index_key_uuid(jack_uuid_t uuid)
+{
+	return _index_mix(uuid);
+}
+
+static void
+_index_free(index_t *index)
+{
+	free(index->slots);
+	index->slots = NULL;
+	index->size = 0;
+	index->used = 0;
+	index->dirty = 0;
+}
+
+static void
+_index_insert(index_t *index, uint64_t key, void *node)
+{
+	const unsigned mask = index->size - 1;
+
+	for(unsigned i = key & mask; ; i = (i + 1) & mask)
+	{
+		index_slot_t *slot = &index->slots[i];
+
+		if(!slot->node || (slot->node == INDEX_TOMBSTONE) )
+		{
+			if(!slot->node)
+				index->dirty++;
+
+			slot->key = key;
+			slot->node = node;
+			index->used++;
+
+			return;
+		}
+	}
+}
+
+static bool
+_index_resize(index_t *index, unsigned size)
+{
+	index_slot_t *slots = calloc(size, sizeof(index_slot_t));
+	if(!slots)
+		return false;
+
+	index_slot_t *old_slots = index->slots;
+	const unsigned old_size = index->size;
+
+	index->slots = slots;
+	index->size = size;
+	index->used = 0;
+	index->dirty = 0;
+
+	// re-insert live nodes, drops tombstones
+	for(unsigned i = 0; i < old_size; i++)
+	{
+		index_slot_t *slot = &old_slots[i];
+
+		if(slot->node && (slot->node != INDEX_TOMBSTONE) )
+			_index_insert(index, slot->key, slot->node);
+	}
+
+	free(old_slots);
+
+	return true;
+}
+
+static void
+_index_add(index_t *index, uint64_t key, void *node)
+{
+	// keep load factor incl. tombstones below 3/4
+	if( (index->dirty + 1)*4 > index->size*3)
+	{
+		unsigned size = 16;
+
+		while(size < (index->used + 1)*2)
+			size <<= 1;
+
+		if(!_index_resize(index, size))
+			return;
+	}
+
+	_index_insert(index, key, node);
+}
+
+static void
+_index_remove(index_t *index, uint64_t key, void *node)
+{
+	if(!index->size)
+		return;
+
+	const unsigned mask = index->size - 1;
+
+	for(unsigned i = key & mask; index->slots[i].node; i = (i + 1) & mask)
+	{
+		index_slot_t *slot = &index->slots[i];
+
+		if( (slot->key == key) && (slot->node == node) )
+		{
+			slot->node = INDEX_TOMBSTONE;
+			index->used--;
+
+			if(!index->used)
+				_index_free(index);
+
+			return;
+		}
+	}
+}
+
+static index_slot_t *
+_index_next(index_t *index, uint64_t key, index_slot_t *slot)
+{
+	const unsigned mask = index->size - 1;
+
+	// nodes with colliding keys are yielded, caller is to compare them
+	for(unsigned i = (slot - index->slots + 1) & mask;
+		index->slots[i].node;
+		i = (i + 1) & mask)
+	{
+		slot = &index->slots[i];
+
+		if( (slot->key == key) && (slot->node != INDEX_TOMBSTONE) )
+			return slot;
+	}
+
+	return NULL;
+}
+
+static index_slot_t *
+_index_first(index_t *index, uint64_t key)
+{
+	if(!index->size)
+		return NULL;
+
+	const unsigned mask = index->size - 1;
+	index_slot_t *slot = &index->slots[key & mask];
+
+	if(!slot->node)
+		return NULL;
+
+	if( (slot->key == key) && (slot->node != INDEX_TOMBSTONE) )
+		return slot;
+
+	return _index_next(index, key, slot);
+}
+
+static inline unsigned
+_shm_stride(unsigned n)
+{
+	return (n + SHM_ALIGN - 1) & ~(SHM_ALIGN - 1);
+}
+
+static inline size_t
+_mixer_shm_ring_offset(unsigned nsinks, unsigned nsources)
+{
+	const size_t offset = sizeof(mixer_shm_t)
+		+ (size_t)nsources * _shm_stride(nsinks + 1) * sizeof(atomic_int);
+
+	return (offset + 63) & ~(size_t)63;
+}
+
+static inline size_t
+_mixer_shm_size(unsigned nsinks, unsigned nsources)
+{
+	return _mixer_shm_ring_offset(nsinks, nsources)
+		+ sizeof(varchunk_t) + MIXER_RING_SIZE;
+}
+
+static inline varchunk_t *
+_mixer_shm_ring(mixer_shm_t *shm)
+{
+	return (varchunk_t *)((uint8_t *)shm + shm->ring);
+}
+
+static inline atomic_int *
+_mixer_shm_gain(mixer_shm_t *shm, unsigned j, unsigned i)
+{
+	return &shm->jgains[j*shm->stride + i];
+}
+
+// crosspoints per source row, CV mixers have an extra DC offset column
+static inline unsigned
+_mixer_shm_ncols(mixer_shm_t *shm)
+{
+#ifdef JACK_HAS_METADATA_API
+	if(shm->type == TYPE_CV)
+		return shm->nsinks + 1;
+#endif
+
+	return shm->nsinks;
+}
+
+static inline size_t
+_monitor_shm_size(unsigned nsinks)
+{
+	return sizeof(monitor_shm_t) + (size_t)nsinks * sizeof(monitor_level_t);
+}
+
+static inline size_t
+_engine_shm_ring_offset(void)
+{
+	return (sizeof(engine_shm_t) + 63) & ~(size_t)63;
+}
+
+static inline size_t
+_engine_shm_size(void)
+{
+	return _engine_shm_ring_offset() + sizeof(varchunk_t) + ENGINE_RING_SIZE;
+}
+
+static inline varchunk_t *
+_engine_shm_ring(engine_shm_t *shm)
+{
+	return (varchunk_t *)((uint8_t *)shm + shm->ring);
+}
+
+// per user and JACK server, so concurrent servers get engines of their own
+static inline void
+_engine_shm_name(char *name, const char *server_name)
+{
+	snprintf(name, ENGINE_SHM_NAME_SIZE, PATCHMATRIX_ENGINE_ID"-%u-%s",
+		(unsigned)getuid(), server_name ? server_name : "default");
+}
+
+// per user and JACK server, so concurrent servers get sockets of their own
+static inline void
+_runtime_addr(struct sockaddr_un *addr, const char *name, const char *server_name)
+{
+	const char *dir = getenv("XDG_RUNTIME_DIR");
+
+	memset(addr, 0x0, sizeof(struct sockaddr_un));
+	addr->sun_family = AF_UNIX;
+
+	if(dir)
+	{
+		snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/%s-%s.sock",
+			dir, name, server_name ? server_name : "default");
+	}
+	else
+	{
+		snprintf(addr->sun_path, sizeof(addr->sun_path), "/tmp/%s-%u-%s.sock",
+			name, (unsigned)getuid(), server_name ? server_name : "default");
+	}
+}
+
+// existing socket was created by us, not planted by another user
+static inline bool
+_runtime_addr_owned(const struct sockaddr_un *addr)
+{
+	struct stat st;
+
+	return (lstat(addr->sun_path, &st) == 0) && S_ISSOCK(st.st_mode)
+		&& (st.st_uid == getuid());
+}
+
+static inline void
+_zygote_addr(struct sockaddr_un *addr, const char *server_name)
+{
+	_runtime_addr(addr, PATCHMATRIX_MIXER, server_name);
+}
+
 #if defined(_WIN32)
 static inline char *
 strsep(char **sp, char *sep)
@@ -490,6 +1027,30 @@ _port_type_to_string(port_type_t port_type)
 	return port_labels[port_type];
 }
 
+static const char *monitor_mode_labels [MONITOR_MODE_MAX] = {
+	[MONITOR_MODE_PEAK] = "peak",
+	[MONITOR_MODE_PPM] = "ppm",
+	[MONITOR_MODE_LUFS] = "lufs"
+};
+
+static monitor_mode_t
+_monitor_mode_from_string(const char *str)
+{
+	for(unsigned mode = 0; mode < MONITOR_MODE_MAX; mode++)
+	{
+		if(!strcasecmp(str, monitor_mode_labels[mode]))
+			return mode;
+	}
+
+	return MONITOR_MODE_PEAK;
+}
+
+static const char *
+_monitor_mode_to_string(monitor_mode_t mode)
+{
+	return monitor_mode_labels[mode];
+}
+
 static const char *designations [DESIGNATION_MAX] = {
 	[DESIGNATION_NONE] = NULL,
 	[DESIGNATION_LEFT] = LV2_PORT_GROUPS__left,
@@ -8,9 +8,18 @@
 
 #include <patchmatrix/patchmatrix.h>
 
+#ifdef JACK_HAS_METADATA_API
+// metadata
+void
+_snapshot_begin(app_t *app);
+
+void
+_snapshot_end(app_t *app);
+#endif
+
 // client
 client_t *
-_client_add(app_t *app, const char *client_name, int client_flags);
+_client_add(app_t *app, const char *client_name, int client_flags, bool hosted);
 
 void
 _client_free(app_t *app, client_t *client);
@@ -33,10 +42,13 @@ port_t *
 _client_find_port_by_name(client_t *client, const char *port_name);
 
 void
-_client_refresh_type(client_t *client);
+_client_sort(client_t *client);
 
 void
-_client_sort(client_t *client);
+_client_dirty(app_t *app, client_t *client, client_dirty_t dirty);
+
+void
+_client_flush(app_t *app);
 
 // client connection
 client_conn_t *
@@ -54,8 +66,9 @@ _client_conn_find(app_t *app, client_t *source_client, client_t *sink_client);
 client_conn_t *
 _client_conn_find_or_add(app_t *app, client_t *source_client, client_t *sink_client);
 
-void
-_client_conn_refresh_type(client_conn_t *client_conn);
+bool
+_client_conn_test(client_conn_t *client_conn, port_t *source_port, port_t *sink_port);
+
 
 // port connection
 port_conn_t *
@@ -80,6 +93,12 @@ _port_free(port_t *port);
 void
 _port_remove(app_t *app, port_t *port);
 
+void
+_port_rename(app_t *app, port_t *port, const char *port_name);
+
+void
+_port_set_type(app_t *app, port_t *port, port_type_t port_type);
+
 port_t *
 _port_find_by_name(app_t *app, const char *port_name);
 
@@ -91,6 +110,14 @@ _port_find_by_uuid(app_t *app, jack_uuid_t port_uuid);
 port_t *
 _port_find_by_body(app_t *app, jack_port_t *body);
 
+// engine
+void
+_engine_spawn(app_t *app);
+
+// mixer spawn server
+void
+_zygote_spawn(app_t *app);
+
 // mixer
 void
 _mixer_spawn(app_t *app, unsigned nsinks, unsigned nsources);
@@ -101,9 +128,15 @@ _mixer_add(const char *client_name);
 void
 _mixer_free(mixer_shm_t *mixer_shm);
 
+void
+_mixer_gain_request(mixer_shm_t *mixer_shm, unsigned j, unsigned i, int32_t mBFS);
+
+bool
+_mixer_ramp_request(mixer_shm_t *mixer_shm, uint32_t ms);
+
 // monitor
 void
-_monitor_spawn(app_t *app, unsigned nsinks);
+_monitor_spawn(app_t *app, unsigned nsinks, monitor_mode_t mode);
 
 monitor_shm_t *
 _monitor_add(const char *client_name);
@@ -0,0 +1,671 @@
+/*
+ * SPDX-FileCopyrightText: Hanspeter Portner <dev@open-music-kontrollers.ch>
+ * SPDX-License-Identifier: Artistic-2.0
+ */
+
+#ifndef _PATCHMATRIX_DSP_H
+#define _PATCHMATRIX_DSP_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#	include <immintrin.h>
+#	define DSP_X86
+#elif defined(__ARM_NEON)
+#	include <arm_neon.h>
+#	define DSP_NEON
+#endif
+
+#define DSP_TP_TAPS 12 // taps per phase of 4x true-peak interpolator
+#define DSP_TP_HIST (DSP_TP_TAPS - 1) // past samples needed by interpolator
+#define DSP_METER_CHUNK 64 // frames per metered sub-block, independent of period size
+
+typedef struct _dsp_t dsp_t;
+typedef struct _dsp_level_t dsp_level_t;
+typedef struct _dsp_meter_t dsp_meter_t;
+
+typedef void (*dsp_mix_t)(float *dst, const float *src, float gain, uint32_t nframes);
+typedef void (*dsp_ramp_t)(float *dst, const float *src, float gain, float step,
+	uint32_t nframes);
+typedef void (*dsp_meter_block_t)(const float *buf, uint32_t nframes, dsp_level_t *lvl);
+
+struct _dsp_level_t {
+	float peak; // sample peak, linear
+	float sum; // sum of squares
+	float true_peak; // peak of 4x oversampled signal, linear
+};
+
+struct _dsp_meter_t {
+	float hist [DSP_TP_HIST]; // last samples of previous period
+	dsp_level_t blk; // levels of current sub-block
+	uint32_t frames; // frames in current sub-block
+	float peak; // integrated sample peak, linear
+	float rms; // integrated RMS of sub-blocks, linear
+	float true_peak; // integrated true-peak, linear
+};
+
+struct _dsp_t {
+	const char *isa;
+	dsp_mix_t mix_set; // dst = gain*src
+	dsp_mix_t mix_add; // dst += gain*src
+	dsp_ramp_t ramp_set; // dst = (gain + k*step)*src
+	dsp_ramp_t ramp_add; // dst += (gain + k*step)*src
+	dsp_meter_block_t meter_block; // accumulate levels of buf[0..nframes-1]
+};
+
+// polyphase FIR of ITU-R BS.1770-4 Annex 2, one row per phase
+static const float dsp_tp_coef [4][DSP_TP_TAPS] = {
+	{
+		 0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f,
+		-0.0594482421875f,  0.1373291015625f,  0.9721679687500f, -0.1022949218750f,
+		 0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f
+	}, {
+		-0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f,
+		-0.1665039062500f,  0.4650878906250f,  0.7797851562500f, -0.2003173828125f,
+		 0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f
+	}, {
+		-0.0189208984375f,  0.0330810546875f, -0.0582275390625f,  0.1015625000000f,
+		-0.2003173828125f,  0.7797851562500f,  0.4650878906250f, -0.1665039062500f,
+		 0.0891113281250f, -0.0517578125000f,  0.0292968750000f, -0.0291748046875f
+	}, {
+		-0.0083007812500f,  0.0148925781250f, -0.0266113281250f,  0.0476074218750f,
+		-0.1022949218750f,  0.9721679687500f,  0.1373291015625f, -0.0594482421875f,
+		 0.0332031250000f, -0.0196533203125f,  0.0109863281250f,  0.0017089843750f
+	}
+};
+
+// scalar fallback
+
+static void
+_dsp_mix_set_scalar(float *dst, const float *src, float gain, uint32_t nframes)
+{
+	for(uint32_t k = 0; k < nframes; k++)
+		dst[k] = gain * src[k];
+}
+
+static void
+_dsp_mix_add_scalar(float *dst, const float *src, float gain, uint32_t nframes)
+{
+	for(uint32_t k = 0; k < nframes; k++)
+		dst[k] += gain * src[k];
+}
+
+static void
+_dsp_ramp_set_scalar(float *dst, const float *src, float gain, float step,
+	uint32_t nframes)
+{
+	for(uint32_t k = 0; k < nframes; k++)
+		dst[k] = (gain + k*step) * src[k];
+}
+
+static void
+_dsp_ramp_add_scalar(float *dst, const float *src, float gain, float step,
+	uint32_t nframes)
+{
+	for(uint32_t k = 0; k < nframes; k++)
+		dst[k] += (gain + k*step) * src[k];
+}
+
+// buf[-DSP_TP_HIST..-1] must hold the preceding samples
+static void
+_dsp_meter_block_scalar(const float *buf, uint32_t nframes, dsp_level_t *lvl)
+{
+	for(uint32_t k = 0; k < nframes; k++)
+	{
+		const float x = buf[k];
+		const float a = fabsf(x);
+
+		if(a > lvl->peak)
+			lvl->peak = a;
+
+		lvl->sum += x*x;
+
+		for(unsigned p = 0; p < 4; p++)
+		{
+			float y = 0.f;
+
+			for(int t = 0; t < DSP_TP_TAPS; t++)
+				y += dsp_tp_coef[p][t] * buf[(int32_t)k - t];
+
+			y = fabsf(y);
+			if(y > lvl->true_peak)
+				lvl->true_peak = y;
+		}
+	}
+}
+
+#if defined(DSP_X86)
+// SSE
+
+__attribute__((target("sse"))) static void
+_dsp_mix_set_sse(float *dst, const float *src, float gain, uint32_t nframes)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	uint32_t k = 0;
+
+	for( ; k + 4 <= nframes; k += 4)
+		_mm_storeu_ps(&dst[k], _mm_mul_ps(g, _mm_loadu_ps(&src[k])));
+
+	_dsp_mix_set_scalar(&dst[k], &src[k], gain, nframes - k);
+}
+
+__attribute__((target("sse"))) static void
+_dsp_mix_add_sse(float *dst, const float *src, float gain, uint32_t nframes)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	uint32_t k = 0;
+
+	for( ; k + 4 <= nframes; k += 4)
+	{
+		const __m128 d = _mm_loadu_ps(&dst[k]);
+
+		_mm_storeu_ps(&dst[k], _mm_add_ps(d, _mm_mul_ps(g, _mm_loadu_ps(&src[k]))));
+	}
+
+	_dsp_mix_add_scalar(&dst[k], &src[k], gain, nframes - k);
+}
+
+__attribute__((target("sse"))) static void
+_dsp_ramp_set_sse(float *dst, const float *src, float gain, float step,
+	uint32_t nframes)
+{
+	const __m128 s = _mm_set1_ps(4*step);
+	__m128 g = _mm_add_ps(_mm_set1_ps(gain),
+		_mm_mul_ps(_mm_set1_ps(step), _mm_setr_ps(0, 1, 2, 3)));
+	uint32_t k = 0;
+
+	for( ; k + 4 <= nframes; k += 4, g = _mm_add_ps(g, s))
+		_mm_storeu_ps(&dst[k], _mm_mul_ps(g, _mm_loadu_ps(&src[k])));
+
+	_dsp_ramp_set_scalar(&dst[k], &src[k], gain + k*step, step, nframes - k);
+}
+
+__attribute__((target("sse"))) static void
+_dsp_ramp_add_sse(float *dst, const float *src, float gain, float step,
+	uint32_t nframes)
+{
+	const __m128 s = _mm_set1_ps(4*step);
+	__m128 g = _mm_add_ps(_mm_set1_ps(gain),
+		_mm_mul_ps(_mm_set1_ps(step), _mm_setr_ps(0, 1, 2, 3)));
+	uint32_t k = 0;
+
+	for( ; k + 4 <= nframes; k += 4, g = _mm_add_ps(g, s))
+	{
+		const __m128 d = _mm_loadu_ps(&dst[k]);
+
+		_mm_storeu_ps(&dst[k], _mm_add_ps(d, _mm_mul_ps(g, _mm_loadu_ps(&src[k]))));
+	}
+
+	_dsp_ramp_add_scalar(&dst[k], &src[k], gain + k*step, step, nframes - k);
+}
+
+__attribute__((target("sse"))) static inline float
+_dsp_hmax_sse(__m128 v)
+{
+	v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+
+	return _mm_cvtss_f32(v);
+}
+
+__attribute__((target("sse"))) static inline float
+_dsp_hsum_sse(__m128 v)
+{
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+
+	return _mm_cvtss_f32(v);
+}
+
+__attribute__((target("sse"))) static void
+_dsp_meter_block_sse(const float *buf, uint32_t nframes, dsp_level_t *lvl)
+{
+	const __m128 sign = _mm_set1_ps(-0.f);
+	__m128 peak = _mm_setzero_ps();
+	__m128 sum = _mm_setzero_ps();
+	__m128 tp = _mm_setzero_ps();
+	uint32_t k = 0;
+
+	for( ; k + 4 <= nframes; k += 4)
+	{
+		const __m128 x = _mm_loadu_ps(&buf[k]);
+
+		peak = _mm_max_ps(peak, _mm_andnot_ps(sign, x));
+		sum = _mm_add_ps(sum, _mm_mul_ps(x, x));
+
+		for(unsigned p = 0; p < 4; p++)
+		{
+			__m128 y = _mm_setzero_ps();
+
+			for(int t = 0; t < DSP_TP_TAPS; t++)
+			{
+				y = _mm_add_ps(y, _mm_mul_ps(_mm_set1_ps(dsp_tp_coef[p][t]),
+					_mm_loadu_ps(&buf[(int32_t)k - t])));
+			}
+
+			tp = _mm_max_ps(tp, _mm_andnot_ps(sign, y));
+		}
+	}
+
+	lvl->peak = fmaxf(lvl->peak, _dsp_hmax_sse(peak));
+	lvl->sum += _dsp_hsum_sse(sum);
+	lvl->true_peak = fmaxf(lvl->true_peak, _dsp_hmax_sse(tp));
+
+	_dsp_meter_block_scalar(&buf[k], nframes - k, lvl);
+}
+
+// AVX
+
+__attribute__((target("avx"))) static void
+_dsp_mix_set_avx(float *dst, const float *src, float gain, uint32_t nframes)
+{
+	const __m256 g = _mm256_set1_ps(gain);
+	uint32_t k = 0;
+
+	for( ; k + 8 <= nframes; k += 8)
+		_mm256_storeu_ps(&dst[k], _mm256_mul_ps(g, _mm256_loadu_ps(&src[k])));
+
+	_dsp_mix_set_scalar(&dst[k], &src[k], gain, nframes - k);
+}
+
+__attribute__((target("avx"))) static void
+_dsp_mix_add_avx(float *dst, const float *src, float gain, uint32_t nframes)
+{
+	const __m256 g = _mm256_set1_ps(gain);
+	uint32_t k = 0;
+
+	for( ; k + 8 <= nframes; k += 8)
+	{
+		const __m256 d = _mm256_loadu_ps(&dst[k]);
+
+		_mm256_storeu_ps(&dst[k], _mm256_add_ps(d, _mm256_mul_ps(g, _mm256_loadu_ps(&src[k]))));
+	}
+
+	_dsp_mix_add_scalar(&dst[k], &src[k], gain, nframes - k);
+}
+
+__attribute__((target("avx"))) static void
+_dsp_ramp_set_avx(float *dst, const float *src, float gain, float step,
+	uint32_t nframes)
+{
+	const __m256 s = _mm256_set1_ps(8*step);
+	__m256 g = _mm256_add_ps(_mm256_set1_ps(gain),
+		_mm256_mul_ps(_mm256_set1_ps(step), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)));
+	uint32_t k = 0;
+
+	for( ; k + 8 <= nframes; k += 8, g = _mm256_add_ps(g, s))
+		_mm256_storeu_ps(&dst[k], _mm256_mul_ps(g, _mm256_loadu_ps(&src[k])));
+
+	_dsp_ramp_set_scalar(&dst[k], &src[k], gain + k*step, step, nframes - k);
+}
+
+__attribute__((target("avx"))) static void
+_dsp_ramp_add_avx(float *dst, const float *src, float gain, float step,
+	uint32_t nframes)
+{
+	const __m256 s = _mm256_set1_ps(8*step);
+	__m256 g = _mm256_add_ps(_mm256_set1_ps(gain),
+		_mm256_mul_ps(_mm256_set1_ps(step), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)));
+	uint32_t k = 0;
+
+	for( ; k + 8 <= nframes; k += 8, g = _mm256_add_ps(g, s))
+	{
+		const __m256 d = _mm256_loadu_ps(&dst[k]);
+
+		_mm256_storeu_ps(&dst[k], _mm256_add_ps(d, _mm256_mul_ps(g, _mm256_loadu_ps(&src[k]))));
+	}
+
+	_dsp_ramp_add_scalar(&dst[k], &src[k], gain + k*step, step, nframes - k);
+}
+
+__attribute__((target("avx"))) static void
+_dsp_meter_block_avx(const float *buf, uint32_t nframes, dsp_level_t *lvl)
+{
+	const __m256 sign = _mm256_set1_ps(-0.f);
+	__m256 peak = _mm256_setzero_ps();
+	__m256 sum = _mm256_setzero_ps();
+	__m256 tp = _mm256_setzero_ps();
+	uint32_t k = 0;
+
+	for( ; k + 8 <= nframes; k += 8)
+	{
+		const __m256 x = _mm256_loadu_ps(&buf[k]);
+
+		peak = _mm256_max_ps(peak, _mm256_andnot_ps(sign, x));
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(x, x));
+
+		for(unsigned p = 0; p < 4; p++)
+		{
+			__m256 y = _mm256_setzero_ps();
+
+			for(int t = 0; t < DSP_TP_TAPS; t++)
+			{
+				y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_set1_ps(dsp_tp_coef[p][t]),
+					_mm256_loadu_ps(&buf[(int32_t)k - t])));
+			}
+
+			tp = _mm256_max_ps(tp, _mm256_andnot_ps(sign, y));
+		}
+	}
+
+	const __m128 peak4 = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+	const __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	const __m128 tp4 = _mm_max_ps(_mm256_castps256_ps128(tp), _mm256_extractf128_ps(tp, 1));
+
+	lvl->peak = fmaxf(lvl->peak, _dsp_hmax_sse(peak4));
+	lvl->sum += _dsp_hsum_sse(sum4);
+	lvl->true_peak = fmaxf(lvl->true_peak, _dsp_hmax_sse(tp4));
+
+	_dsp_meter_block_scalar(&buf[k], nframes - k, lvl);
+}
+
+// AVX-512
+
+__attribute__((target("avx512f"))) static void
+_dsp_mix_set_avx512(float *dst, const float *src, float gain, uint32_t nframes)
+{
+	const __m512 g = _mm512_set1_ps(gain);
+	uint32_t k = 0;
+
+	for( ; k + 16 <= nframes; k += 16)
+		_mm512_storeu_ps(&dst[k], _mm512_mul_ps(g, _mm512_loadu_ps(&src[k])));
+
+	_dsp_mix_set_scalar(&dst[k], &src[k], gain, nframes - k);
+}
+
+__attribute__((target("avx512f"))) static void
+_dsp_mix_add_avx512(float *dst, const float *src, float gain, uint32_t nframes)
+{
+	const __m512 g = _mm512_set1_ps(gain);
+	uint32_t k = 0;
+
+	for( ; k + 16 <= nframes; k += 16)
+	{
+		const __m512 d = _mm512_loadu_ps(&dst[k]);
+
+		_mm512_storeu_ps(&dst[k], _mm512_add_ps(d, _mm512_mul_ps(g, _mm512_loadu_ps(&src[k]))));
+	}
+
+	_dsp_mix_add_scalar(&dst[k], &src[k], gain, nframes - k);
+}
+
+__attribute__((target("avx512f"))) static void
+_dsp_ramp_set_avx512(float *dst, const float *src, float gain, float step,
+	uint32_t nframes)
+{
+	const __m512 s = _mm512_set1_ps(16*step);
+	__m512 g = _mm512_add_ps(_mm512_set1_ps(gain),
+		_mm512_mul_ps(_mm512_set1_ps(step), _mm512_set_ps(
+			15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)));
+	uint32_t k = 0;
+
+	for( ; k + 16 <= nframes; k += 16, g = _mm512_add_ps(g, s))
+		_mm512_storeu_ps(&dst[k], _mm512_mul_ps(g, _mm512_loadu_ps(&src[k])));
+
+	_dsp_ramp_set_scalar(&dst[k], &src[k], gain + k*step, step, nframes - k);
+}
+
+__attribute__((target("avx512f"))) static void
+_dsp_ramp_add_avx512(float *dst, const float *src, float gain, float step,
+	uint32_t nframes)
+{
+	const __m512 s = _mm512_set1_ps(16*step);
+	__m512 g = _mm512_add_ps(_mm512_set1_ps(gain),
+		_mm512_mul_ps(_mm512_set1_ps(step), _mm512_set_ps(
+			15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)));
+	uint32_t k = 0;
+
+	for( ; k + 16 <= nframes; k += 16, g = _mm512_add_ps(g, s))
+	{
+		const __m512 d = _mm512_loadu_ps(&dst[k]);
+
+		_mm512_storeu_ps(&dst[k], _mm512_add_ps(d, _mm512_mul_ps(g, _mm512_loadu_ps(&src[k]))));
+	}
+
+	_dsp_ramp_add_scalar(&dst[k], &src[k], gain + k*step, step, nframes - k);
+}
+
+__attribute__((target("avx512f"))) static void
+_dsp_meter_block_avx512(const float *buf, uint32_t nframes, dsp_level_t *lvl)
+{
+	__m512 peak = _mm512_setzero_ps();
+	__m512 sum = _mm512_setzero_ps();
+	__m512 tp = _mm512_setzero_ps();
+	uint32_t k = 0;
+
+	for( ; k + 16 <= nframes; k += 16)
+	{
+		const __m512 x = _mm512_loadu_ps(&buf[k]);
+
+		peak = _mm512_max_ps(peak, _mm512_abs_ps(x));
+		sum = _mm512_fmadd_ps(x, x, sum);
+
+		for(unsigned p = 0; p < 4; p++)
+		{
+			__m512 y = _mm512_setzero_ps();
+
+			for(int t = 0; t < DSP_TP_TAPS; t++)
+			{
+				y = _mm512_fmadd_ps(_mm512_set1_ps(dsp_tp_coef[p][t]),
+					_mm512_loadu_ps(&buf[(int32_t)k - t]), y);
+			}
+
+			tp = _mm512_max_ps(tp, _mm512_abs_ps(y));
+		}
+	}
+
+	lvl->peak = fmaxf(lvl->peak, _mm512_reduce_max_ps(peak));
+	lvl->sum += _mm512_reduce_add_ps(sum);
+	lvl->true_peak = fmaxf(lvl->true_peak, _mm512_reduce_max_ps(tp));
+
+	_dsp_meter_block_scalar(&buf[k], nframes - k, lvl);
+}
+#elif defined(DSP_NEON)
+// NEON
+
+static void
+_dsp_mix_set_neon(float *dst, const float *src, float gain, uint32_t nframes)
+{
+	const float32x4_t g = vdupq_n_f32(gain);
+	uint32_t k = 0;
+
+	for( ; k + 4 <= nframes; k += 4)
+		vst1q_f32(&dst[k], vmulq_f32(g, vld1q_f32(&src[k])));
+
+	_dsp_mix_set_scalar(&dst[k], &src[k], gain, nframes - k);
+}
+
+static void
+_dsp_mix_add_neon(float *dst, const float *src, float gain, uint32_t nframes)
+{
+	const float32x4_t g = vdupq_n_f32(gain);
+	uint32_t k = 0;
+
+	for( ; k + 4 <= nframes; k += 4)
+		vst1q_f32(&dst[k], vmlaq_f32(vld1q_f32(&dst[k]), g, vld1q_f32(&src[k])));
+
+	_dsp_mix_add_scalar(&dst[k], &src[k], gain, nframes - k);
+}
+
+static void
+_dsp_ramp_set_neon(float *dst, const float *src, float gain, float step,
+	uint32_t nframes)
+{
+	static const float idx [4] = {0, 1, 2, 3};
+	const float32x4_t s = vdupq_n_f32(4*step);
+	float32x4_t g = vmlaq_f32(vdupq_n_f32(gain), vdupq_n_f32(step), vld1q_f32(idx));
+	uint32_t k = 0;
+
+	for( ; k + 4 <= nframes; k += 4, g = vaddq_f32(g, s))
+		vst1q_f32(&dst[k], vmulq_f32(g, vld1q_f32(&src[k])));
+
+	_dsp_ramp_set_scalar(&dst[k], &src[k], gain + k*step, step, nframes - k);
+}
+
+static void
+_dsp_ramp_add_neon(float *dst, const float *src, float gain, float step,
+	uint32_t nframes)
+{
+	static const float idx [4] = {0, 1, 2, 3};
+	const float32x4_t s = vdupq_n_f32(4*step);
+	float32x4_t g = vmlaq_f32(vdupq_n_f32(gain), vdupq_n_f32(step), vld1q_f32(idx));
+	uint32_t k = 0;
+
+	for( ; k + 4 <= nframes; k += 4, g = vaddq_f32(g, s))
+		vst1q_f32(&dst[k], vmlaq_f32(vld1q_f32(&dst[k]), g, vld1q_f32(&src[k])));
+
+	_dsp_ramp_add_scalar(&dst[k], &src[k], gain + k*step, step, nframes - k);
+}
+
+static void
+_dsp_meter_block_neon(const float *buf, uint32_t nframes, dsp_level_t *lvl)
+{
+	float32x4_t peak = vdupq_n_f32(0.f);
+	float32x4_t sum = vdupq_n_f32(0.f);
+	float32x4_t tp = vdupq_n_f32(0.f);
+	uint32_t k = 0;
+
+	for( ; k + 4 <= nframes; k += 4)
+	{
+		const float32x4_t x = vld1q_f32(&buf[k]);
+
+		peak = vmaxq_f32(peak, vabsq_f32(x));
+		sum = vmlaq_f32(sum, x, x);
+
+		for(unsigned p = 0; p < 4; p++)
+		{
+			float32x4_t y = vdupq_n_f32(0.f);
+
+			for(int t = 0; t < DSP_TP_TAPS; t++)
+				y = vmlaq_n_f32(y, vld1q_f32(&buf[(int32_t)k - t]), dsp_tp_coef[p][t]);
+
+			tp = vmaxq_f32(tp, vabsq_f32(y));
+		}
+	}
+
+	float v [4];
+
+	vst1q_f32(v, peak);
+	lvl->peak = fmaxf(lvl->peak, fmaxf(fmaxf(v[0], v[1]), fmaxf(v[2], v[3])));
+	vst1q_f32(v, sum);
+	lvl->sum += (v[0] + v[1]) + (v[2] + v[3]);
+	vst1q_f32(v, tp);
+	lvl->true_peak = fmaxf(lvl->true_peak, fmaxf(fmaxf(v[0], v[1]), fmaxf(v[2], v[3])));
+
+	_dsp_meter_block_scalar(&buf[k], nframes - k, lvl);
+}
+#endif
+
+// integrator coefficient per sub-block for time constant tau in s, zero for instant
+static inline float
+_dsp_meter_attack(float tau, float sample_rate)
+{
+	return (tau > 0.f)
+		? 1.f - expf(-DSP_METER_CHUNK / (tau * sample_rate))
+		: 1.f;
+}
+
+// charge integrator with rectified level x, release is up to the caller
+static inline void
+_dsp_meter_integrate(float *env, float x, float attack)
+{
+	if(x > *env)
+		*env += (x - *env) * attack;
+}
+
+// meter nframes of src, sub-blocks continue across calls
+static inline void
+_dsp_meter(const dsp_t *dsp, const float *src, uint32_t nframes, dsp_meter_t *meter,
+	float attack)
+{
+	float buf [DSP_TP_HIST + DSP_METER_CHUNK];
+
+	memcpy(buf, meter->hist, DSP_TP_HIST*sizeof(float));
+
+	for(uint32_t k = 0, n; k < nframes; k += n)
+	{
+		n = DSP_METER_CHUNK - meter->frames;
+		if(n > nframes - k)
+			n = nframes - k;
+
+		memcpy(&buf[DSP_TP_HIST], &src[k], n*sizeof(float));
+		dsp->meter_block(&buf[DSP_TP_HIST], n, &meter->blk);
+		memmove(buf, &buf[n], DSP_TP_HIST*sizeof(float));
+
+		meter->frames += n;
+		if(meter->frames < DSP_METER_CHUNK)
+			continue;
+
+		dsp_level_t *blk = &meter->blk;
+
+		_dsp_meter_integrate(&meter->peak, blk->peak, attack);
+		_dsp_meter_integrate(&meter->rms, sqrtf(blk->sum / DSP_METER_CHUNK), attack);
+		_dsp_meter_integrate(&meter->true_peak, fmaxf(blk->true_peak, blk->peak), attack);
+
+		*blk = (dsp_level_t){ .peak = 0.f, .sum = 0.f, .true_peak = 0.f };
+		meter->frames = 0;
+	}
+
+	memcpy(meter->hist, buf, DSP_TP_HIST*sizeof(float));
+}
+
+// pick widest instruction set supported by the running CPU
+static void
+_dsp_init(dsp_t *dsp)
+{
+#if defined(DSP_X86)
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx512f"))
+	{
+		dsp->isa = "avx512";
+		dsp->mix_set = _dsp_mix_set_avx512;
+		dsp->mix_add = _dsp_mix_add_avx512;
+		dsp->ramp_set = _dsp_ramp_set_avx512;
+		dsp->ramp_add = _dsp_ramp_add_avx512;
+		dsp->meter_block = _dsp_meter_block_avx512;
+		return;
+	}
+
+	if(__builtin_cpu_supports("avx"))
+	{
+		dsp->isa = "avx";
+		dsp->mix_set = _dsp_mix_set_avx;
+		dsp->mix_add = _dsp_mix_add_avx;
+		dsp->ramp_set = _dsp_ramp_set_avx;
+		dsp->ramp_add = _dsp_ramp_add_avx;
+		dsp->meter_block = _dsp_meter_block_avx;
+		return;
+	}
+
+	if(__builtin_cpu_supports("sse"))
+	{
+		dsp->isa = "sse";
+		dsp->mix_set = _dsp_mix_set_sse;
+		dsp->mix_add = _dsp_mix_add_sse;
+		dsp->ramp_set = _dsp_ramp_set_sse;
+		dsp->ramp_add = _dsp_ramp_add_sse;
+		dsp->meter_block = _dsp_meter_block_sse;
+		return;
+	}
+#elif defined(DSP_NEON)
+	dsp->isa = "neon";
+	dsp->mix_set = _dsp_mix_set_neon;
+	dsp->mix_add = _dsp_mix_add_neon;
+	dsp->ramp_set = _dsp_ramp_set_neon;
+	dsp->ramp_add = _dsp_ramp_add_neon;
+	dsp->meter_block = _dsp_meter_block_neon;
+	return;
+#endif
+
+	dsp->isa = "scalar";
+	dsp->mix_set = _dsp_mix_set_scalar;
+	dsp->mix_add = _dsp_mix_add_scalar;
+	dsp->ramp_set = _dsp_ramp_set_scalar;
+	dsp->ramp_add = _dsp_ramp_add_scalar;
+	dsp->meter_block = _dsp_meter_block_scalar;
+}
+
+#endif
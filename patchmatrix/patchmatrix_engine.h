@@ -0,0 +1,34 @@
+/*
+ * SPDX-FileCopyrightText: Hanspeter Portner <dev@open-music-kontrollers.ch>
+ * SPDX-License-Identifier: Artistic-2.0
+ */
+
+#ifndef _PATCHMATRIX_ENGINE_H
+#define _PATCHMATRIX_ENGINE_H
+
+#include <patchmatrix/patchmatrix.h>
+
+#define ENGINE_UNIT_MAX 256 // mixers and monitors hosted per engine
+#define ENGINE_NAME_SIZE 64 // unit names, prefixed to their port names
+
+typedef struct _unit_t unit_t;
+
+// mixer or monitor hosted inside the engine client
+struct _unit_t {
+	char name [ENGINE_NAME_SIZE]; // shm name, ports are registered as name/port
+	void *data; // NULL for unused slots
+	JackProcessCallback process;
+	void (*free)(void *data);
+	sem_t *done; // posted by UI to close unit
+	atomic_bool *closing;
+};
+
+bool
+_mixer_unit_new(unit_t *unit, jack_client_t *client, port_type_t type,
+	unsigned nsinks, unsigned nsources);
+
+bool
+_monitor_unit_new(unit_t *unit, jack_client_t *client, port_type_t type,
+	unsigned nsinks, monitor_mode_t mode);
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: Hanspeter Portner <dev@open-music-kontrollers.ch>
+ * SPDX-License-Identifier: Artistic-2.0
+ */
+
+#ifndef _PATCHMATRIX_GAIN_H
+#define _PATCHMATRIX_GAIN_H
+
+#include <stdint.h>
+#include <math.h>
+
+#define GAIN_MIN -3600 // mBFS, connection not to be mixed
+#define GAIN_MAX 3600 // mBFS
+#define GAIN_DBFS_ERROR 2.5e-5f // dB, bound of _gain_to_dBFS for x in [2^-24, 2^12]
+#define GAIN_UNITY_CV 1000 // CV crosspoints are linear, in thousandths
+
+static float gain_lut [GAIN_MAX - GAIN_MIN + 1];
+
+// fill lookup table, call once at startup, outside of RT thread
+static void
+_gain_init(void)
+{
+	for(int32_t mBFS = GAIN_MIN; mBFS <= GAIN_MAX; mBFS++)
+		gain_lut[mBFS - GAIN_MIN] = exp10f(mBFS / 2000.f); // mBFS = 2000*log10(gain)
+
+	gain_lut[0] = 0.f;
+}
+
+// linear gain for given mBFS, zero at and below GAIN_MIN
+static inline float
+_gain_from_mBFS(int32_t mBFS)
+{
+	if(mBFS <= GAIN_MIN)
+		return 0.f;
+	else if(mBFS > GAIN_MAX)
+		mBFS = GAIN_MAX;
+
+	return gain_lut[mBFS - GAIN_MIN];
+}
+
+// linear CV gain or offset for given crosspoint value, without dB mapping
+static inline float
+_gain_from_cv(int32_t mval)
+{
+	if(mval < GAIN_MIN)
+		mval = GAIN_MIN;
+	else if(mval > GAIN_MAX)
+		mval = GAIN_MAX;
+
+	return mval / (float)GAIN_UNITY_CV;
+}
+
+// fast approximation of 20*log10(x) for x > 0, error below GAIN_DBFS_ERROR
+static inline float
+_gain_to_dBFS(float x)
+{
+	union {
+		float f;
+		int32_t i;
+	} v = { .f = x };
+
+	int32_t e = ((v.i >> 23) & 0xff) - 127;
+	v.i = (v.i & 0x007fffff) | 0x3f800000; // mantissa in [1, 2)
+
+	if(v.f > 1.41421356f) // center mantissa around 1 for faster convergence
+	{
+		v.f *= 0.5f;
+		e += 1;
+	}
+
+	// ln(m) = 2*atanh(t) with t = (m - 1)/(m + 1) and |t| < 0.172
+	const float t = (v.f - 1.f) / (v.f + 1.f);
+	const float t2 = t*t;
+	const float ln = 2.f*t*(1.f + t2*(1.f/3.f + t2*(1.f/5.f)));
+
+	return 6.02059991f*e + 8.68588964f*ln; // 20*log10(2)*e + 20*log10(e)*ln
+}
+
+#endif
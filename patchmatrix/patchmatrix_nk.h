@@ -17,4 +17,7 @@ _ui_deinit(app_t *app);
 void
 _ui_signal(app_t *app);
 
+bool
+_ui_damaged(app_t *app);
+
 #endif
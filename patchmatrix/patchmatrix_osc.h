@@ -0,0 +1,261 @@
+/*
+ * SPDX-FileCopyrightText: Hanspeter Portner <dev@open-music-kontrollers.ch>
+ * SPDX-License-Identifier: Artistic-2.0
+ */
+
+#ifndef _PATCHMATRIX_OSC_H
+#define _PATCHMATRIX_OSC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define OSC_PATTERN_OPS 64 // compiled operations per pattern
+#define OSC_PATTERN_ALTS 256 // characters of all {...} alternatives per pattern
+#define OSC_PATH_MAX 511 // longest path to match against, without terminator
+#define OSC_OFFS_WORDS ((OSC_PATH_MAX + 1) / 64)
+
+typedef struct _osc_op_t osc_op_t;
+typedef struct _osc_pattern_t osc_pattern_t;
+
+typedef enum _osc_op_type_t {
+	OSC_OP_CHAR, // literal character
+	OSC_OP_ANY, // '?', any single character but '/'
+	OSC_OP_STAR, // '*', any run of characters but '/'
+	OSC_OP_SET, // '[...]', single character in (or not in) set
+	OSC_OP_ALT // '{...}', one of comma-separated literals
+} osc_op_type_t;
+
+struct _osc_op_t {
+	osc_op_type_t type;
+	union {
+		char chr; // OSC_OP_CHAR
+		uint32_t set [8]; // OSC_OP_SET, bitmap over all 256 characters
+		struct {
+			uint16_t off;
+			uint16_t len;
+		} alt; // OSC_OP_ALT, range in alts
+	};
+};
+
+// address pattern compiled once outside of RT thread, matched without allocation
+struct _osc_pattern_t {
+	unsigned nops;
+	osc_op_t ops [OSC_PATTERN_OPS];
+	char alts [OSC_PATTERN_ALTS];
+};
+
+static inline void
+_osc_set_add(uint32_t *set, uint8_t c)
+{
+	set[c >> 5] |= 1U << (c & 0x1f);
+}
+
+static inline bool
+_osc_set_has(const uint32_t *set, uint8_t c)
+{
+	return set[c >> 5] & (1U << (c & 0x1f));
+}
+
+// returns false for malformed or too long patterns
+static bool
+_osc_pattern_compile(osc_pattern_t *pat, const char *str)
+{
+	unsigned nalts = 0;
+
+	memset(pat, 0x0, sizeof(osc_pattern_t));
+
+	if(*str != '/')
+		return false;
+
+	while(*str)
+	{
+		if(pat->nops >= OSC_PATTERN_OPS)
+			return false;
+
+		osc_op_t *op = &pat->ops[pat->nops++];
+
+		switch(*str)
+		{
+			case '?':
+			{
+				op->type = OSC_OP_ANY;
+				str++;
+			} break;
+			case '*':
+			{
+				op->type = OSC_OP_STAR;
+				while(*str == '*') // consecutive stars are redundant
+					str++;
+			} break;
+			case '[':
+			{
+				const bool negate = (*++str == '!');
+				if(negate)
+					str++;
+
+				op->type = OSC_OP_SET;
+				while(*str && (*str != ']'))
+				{
+					uint8_t lo = *str++;
+					uint8_t hi = lo;
+
+					if( (*str == '-') && str[1] && (str[1] != ']') ) // range
+					{
+						hi = str[1];
+						str += 2;
+					}
+
+					for(unsigned c = lo; c <= hi; c++)
+						_osc_set_add(op->set, c);
+				}
+
+				if(*str++ != ']')
+					return false;
+
+				if(negate)
+				{
+					for(unsigned i = 0; i < 8; i++)
+						op->set[i] = ~op->set[i];
+				}
+
+				op->set[0] &= ~1U; // never match string terminator
+				op->set['/' >> 5] &= ~(1U << ('/' & 0x1f)); // nor separator
+			} break;
+			case '{':
+			{
+				const char *end = strchr(++str, '}');
+				if(!end)
+					return false;
+
+				const size_t len = end - str;
+				if(nalts + len + 1 > OSC_PATTERN_ALTS)
+					return false;
+
+				op->type = OSC_OP_ALT;
+				op->alt.off = nalts;
+				op->alt.len = len;
+				memcpy(&pat->alts[nalts], str, len);
+				nalts += len + 1; // keep zero-terminated
+
+				str = end + 1;
+			} break;
+			case ']':
+			case '}':
+			{
+				return false;
+			} break;
+			default:
+			{
+				op->type = OSC_OP_CHAR;
+				op->chr = *str++;
+			} break;
+		}
+	}
+
+	return true;
+}
+
+static inline void
+_osc_offs_add(uint64_t *offs, size_t o)
+{
+	offs[o >> 6] |= 1ULL << (o & 0x3f);
+}
+
+static inline bool
+_osc_offs_has(const uint64_t *offs, size_t o)
+{
+	return offs[o >> 6] & (1ULL << (o & 0x3f));
+}
+
+// advances all partial matches by one op at once, without backtracking,
+// thus bounded by ops * path length even for patterns with many '*' or '{...}'
+static inline bool
+_osc_pattern_match(const osc_pattern_t *pat, const char *path)
+{
+	const size_t len = strnlen(path, OSC_PATH_MAX + 1);
+	if(len > OSC_PATH_MAX)
+		return false;
+
+	uint64_t cur [OSC_OFFS_WORDS] = { 1 }; // path offsets matched so far
+	uint64_t nxt [OSC_OFFS_WORDS];
+
+	for(unsigned i = 0; i < pat->nops; i++)
+	{
+		const osc_op_t *op = &pat->ops[i];
+		size_t star = 0; // offsets below are covered by a preceding run
+		bool alive = false;
+
+		memset(nxt, 0x0, sizeof(nxt));
+
+		for(size_t o = 0; o <= len; o++)
+		{
+			if(!_osc_offs_has(cur, o))
+				continue;
+
+			alive = true;
+
+			switch(op->type)
+			{
+				case OSC_OP_CHAR:
+				{
+					if(path[o] == op->chr)
+						_osc_offs_add(nxt, o + 1);
+				} break;
+				case OSC_OP_ANY:
+				{
+					if(path[o] && (path[o] != '/'))
+						_osc_offs_add(nxt, o + 1);
+				} break;
+				case OSC_OP_SET:
+				{
+					if(_osc_set_has(op->set, path[o]))
+						_osc_offs_add(nxt, o + 1);
+				} break;
+				case OSC_OP_STAR:
+				{
+					if(o < star) // run up to same separator added already
+						break;
+
+					// any run, never beyond next separator
+					for(star = o; ; star++)
+					{
+						_osc_offs_add(nxt, star);
+
+						if(!path[star] || (path[star] == '/'))
+							break;
+					}
+
+					star++;
+				} break;
+				case OSC_OP_ALT:
+				{
+					const char *alt = &pat->alts[op->alt.off];
+					const char *end = alt + op->alt.len;
+
+					while(alt <= end)
+					{
+						const char *sep = memchr(alt, ',', end - alt);
+						if(!sep)
+							sep = end;
+
+						const size_t n = sep - alt;
+						if(!strncmp(&path[o], alt, n))
+							_osc_offs_add(nxt, o + n);
+
+						alt = sep + 1;
+					}
+				} break;
+			}
+		}
+
+		if(!alive)
+			return false;
+
+		memcpy(cur, nxt, sizeof(cur));
+	}
+
+	return _osc_offs_has(cur, len);
+}
+
+#endif
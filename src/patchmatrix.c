@@ -6,6 +6,7 @@
 #include <sys/wait.h>
 
 #include <patchmatrix/patchmatrix.h>
+#include <patchmatrix/patchmatrix_db.h>
 #include <patchmatrix/patchmatrix_jack.h>
 #include <patchmatrix/patchmatrix_nk.h>
 
@@ -43,6 +44,7 @@ main(int argc, char **argv)
 	app.nxt_default = 30;
 
 	app.server_name = NULL;
+	app.refresh_rate = 25;
 
 	fprintf(stderr,
 		"%s "PATCHMATRIX_VERSION"\n"
@@ -50,7 +52,7 @@ main(int argc, char **argv)
 		"Released under Artistic License 2.0 by Open Music Kontrollers\n", argv[0]);
 
 	int c;
-	while((c = getopt(argc, argv, "vhn:")) != -1)
+	while((c = getopt(argc, argv, "vhn:r:ez")) != -1)
 	{
 		switch(c)
 		{
@@ -79,14 +81,26 @@ main(int argc, char **argv)
 					"OPTIONS\n"
 					"   [-v]                 print version and full license information\n"
 					"   [-h]                 print usage information\n"
-					"   [-n] server-name     connect to named JACK daemon\n\n"
+					"   [-n] server-name     connect to named JACK daemon\n"
+					"   [-r] refresh-rate    maximal meter refresh rate in Hz (1-200)\n"
+					"   [-e]                 host mixers and monitors in a shared engine client\n"
+					"   [-z]                 spawn mixers via pre-forked spawn server\n\n"
 					, argv[0]);
 				return 0;
 			case 'n':
 				app.server_name = optarg;
 				break;
+			case 'r':
+				app.refresh_rate = NK_CLAMP(1, atoi(optarg), 200);
+				break;
+			case 'e':
+				app.engine = true;
+				break;
+			case 'z':
+				app.zygote = true;
+				break;
 			case '?':
-				if( (optopt == 'n') || (optopt == 'u') || (optopt == 'd') )
+				if( (optopt == 'n') || (optopt == 'u') || (optopt == 'd') || (optopt == 'r') )
 					fprintf(stderr, "Option `-%c' requires an argument.\n", optopt);
 				else if(isprint(optopt))
 					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -110,6 +124,12 @@ main(int argc, char **argv)
 	if(_jack_init(&app))
 		goto cleanup;
 
+	if(app.engine)
+		_engine_spawn(&app);
+
+	if(app.zygote)
+		_zygote_spawn(&app);
+
 	while(!atomic_load_explicit(&app.done, memory_order_acquire))
 	{
 		if(!app.animating)
@@ -118,8 +138,12 @@ main(int argc, char **argv)
 		}
 		else
 		{
-			usleep(1000000 / 25); //FIXME
-			nk_pugl_post_redisplay(&app.win);
+			// handle window events until next meter frame is due
+			puglUpdate(app.win.world, 1.0 / app.refresh_rate);
+
+			// skip frames where no meter or gain has changed
+			if(_ui_damaged(&app))
+				nk_pugl_post_redisplay(&app.win);
 		}
 
 		if(  _jack_anim(&app)
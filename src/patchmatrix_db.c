@@ -10,18 +10,162 @@
 #include <patchmatrix/patchmatrix_db.h>
 #include <patchmatrix/patchmatrix_jack.h>
 
+// type reference counting
+static void
+_type_ref(unsigned type_refs [TYPE_BITS], port_type_t *type, port_type_t port_type)
+{
+	for(unsigned b = 0; b < TYPE_BITS; b++)
+	{
+		if( (port_type & (1 << b)) && (type_refs[b]++ == 0) )
+			*type |= (1 << b);
+	}
+}
+
+static void
+_type_unref(unsigned type_refs [TYPE_BITS], port_type_t *type, port_type_t port_type)
+{
+	for(unsigned b = 0; b < TYPE_BITS; b++)
+	{
+		if( (port_type & (1 << b)) && type_refs[b] && (--type_refs[b] == 0) )
+			*type &= ~(1 << b);
+	}
+}
+
+static void
+_client_type_ref(port_t *port)
+{
+	client_t *client = port->client;
+
+	if(port->is_input)
+		_type_ref(client->sink_type_refs, &client->sink_type, port->type);
+	else
+		_type_ref(client->source_type_refs, &client->source_type, port->type);
+}
+
+static void
+_client_type_unref(port_t *port)
+{
+	client_t *client = port->client;
+
+	if(port->is_input)
+		_type_unref(client->sink_type_refs, &client->sink_type, port->type);
+	else
+		_type_unref(client->source_type_refs, &client->source_type, port->type);
+}
+
+static port_type_t
+_port_conn_type(port_conn_t *port_conn)
+{
+	return port_conn->source_port->type | port_conn->sink_port->type;
+}
+
+#ifdef JACK_HAS_METADATA_API
+// metadata
+void
+_snapshot_begin(app_t *app)
+{
+	// fetch metadata of all subjects in one go
+	app->snapshot.descs = NULL;
+	app->snapshot.ndescs = jack_get_all_properties(&app->snapshot.descs);
+	if(app->snapshot.ndescs < 0)
+	{
+		app->snapshot.ndescs = 0;
+		return; // fall back to per-subject queries
+	}
+
+	for(int i = 0; i < app->snapshot.ndescs; i++)
+	{
+		jack_description_t *desc = &app->snapshot.descs[i];
+
+		_index_add(&app->snapshot.subjects, _index_key_uuid(desc->subject), desc);
+	}
+
+	app->snapshot.active = true;
+}
+
+void
+_snapshot_end(app_t *app)
+{
+	for(int i = 0; i < app->snapshot.ndescs; i++)
+	{
+		jack_description_t *desc = &app->snapshot.descs[i];
+
+		jack_free_description(desc, 0);
+	}
+
+	if(app->snapshot.descs)
+		jack_free(app->snapshot.descs);
+
+	_index_free(&app->snapshot.subjects);
+
+	app->snapshot.active = false;
+	app->snapshot.descs = NULL;
+	app->snapshot.ndescs = 0;
+}
+
+static const jack_description_t *
+_description_get(app_t *app, jack_uuid_t uuid, jack_description_t *tmp)
+{
+	if(app->snapshot.active)
+	{
+		INDEX_FOREACH(&app->snapshot.subjects, _index_key_uuid(uuid), desc_itr)
+		{
+			const jack_description_t *desc = desc_itr->node;
+
+			if(!jack_uuid_compare(desc->subject, uuid))
+			{
+				return desc;
+			}
+		}
+
+		return NULL; // subject has no properties
+	}
+
+	// query all properties of subject in a single round-trip
+	memset(tmp, 0x0, sizeof(jack_description_t));
+	if(jack_get_properties(uuid, tmp) < 0)
+		return NULL;
+
+	return tmp;
+}
+
+static void
+_description_put(app_t *app, const jack_description_t *desc, jack_description_t *tmp)
+{
+	if(desc == tmp)
+		jack_free_description(tmp, 0);
+}
+
+static const char *
+_description_value(const jack_description_t *desc, const char *key)
+{
+	if(!desc)
+		return NULL;
+
+	for(uint32_t i = 0; i < desc->property_cnt; i++)
+	{
+		const jack_property_t *prop = &desc->properties[i];
+
+		if(prop->key && !strcmp(prop->key, key))
+		{
+			return prop->data;
+		}
+	}
+
+	return NULL;
+}
+#endif
+
 // client
 #ifdef JACK_HAS_METADATA_API
 static void
-_client_get_or_set_pos_x(app_t *app, client_t *client, const char *property)
+_client_get_or_set_pos_x(app_t *app, client_t *client,
+	const jack_description_t *desc, const char *property)
 {
-	char *value = NULL;
-	char *type = NULL;
-	jack_get_property(client->uuid, property, &value, &type);
+	const char *value = _description_value(desc, property);
 	if(value)
 	{
 		client->pos.x = atof(value);
-		jack_free(value);
 	}
 	else // set, if not already set
 	{
@@ -29,20 +173,16 @@ _client_get_or_set_pos_x(app_t *app, client_t *client, const char *property)
 		snprintf(val, 32, "%f", client->pos.x);
 		jack_set_property(app->client, client->uuid, property, val, XSD__float);
 	}
-	if(type)
-		jack_free(type);
 }
 
 static void
-_client_get_or_set_pos_y(app_t *app, client_t *client, const char *property)
+_client_get_or_set_pos_y(app_t *app, client_t *client,
+	const jack_description_t *desc, const char *property)
 {
-	char *value = NULL;
-	char *type = NULL;
-	jack_get_property(client->uuid, property, &value, &type);
+	const char *value = _description_value(desc, property);
 	if(value)
 	{
 		client->pos.y = atof(value);
-		jack_free(value);
 	}
 	else // set, if not already set
 	{
@@ -50,13 +190,32 @@ _client_get_or_set_pos_y(app_t *app, client_t *client, const char *property)
 		snprintf(val, 32, "%f", client->pos.y);
 		jack_set_property(app->client, client->uuid, property, val, XSD__float);
 	}
-	if(type)
-		jack_free(type);
 }
 #endif
 
+// headless patchbay lays out new clients on a canvas of default window size
+static inline float
+_canvas_width(app_t *app)
+{
+#ifdef PATCHMATRIX_HEADLESS
+	return 1280 * app->scale;
+#else
+	return app->win.cfg.width;
+#endif
+}
+
+static inline float
+_canvas_height(app_t *app)
+{
+#ifdef PATCHMATRIX_HEADLESS
+	return 720 * app->scale;
+#else
+	return app->win.cfg.height;
+#endif
+}
+
 client_t *
-_client_add(app_t *app, const char *client_name, int client_flags)
+_client_add(app_t *app, const char *client_name, int client_flags, bool hosted)
 {
 	client_t *client = calloc(1, sizeof(client_t));
 	if(client)
@@ -64,6 +223,7 @@ _client_add(app_t *app, const char *client_name, int client_flags)
 		client->name = strdup(client_name);
 		client->pretty_name = NULL;
 		client->flags = client_flags;
+		client->hosted = hosted;
 
 		const float w = 200.f * app->scale;
 		const float h = 25.f * app->scale;
@@ -76,21 +236,24 @@ _client_add(app_t *app, const char *client_name, int client_flags)
 		}
 		else if(client->flags == JackPortIsInput)
 		{
-			x = app->win.cfg.width - w/2 - 10;
+			x = _canvas_width(app) - w/2 - 10;
 			nxt = &app->nxt_sink;
 		}
 		else
 		{
-			x = app->win.cfg.width/2;
+			x = _canvas_width(app)/2;
 			nxt = &app->nxt_default;
 		}
 
-		*nxt = fmodf(*nxt + 2*h, app->win.cfg.height);
+		*nxt = fmodf(*nxt + 2*h, _canvas_height(app));
 
 		client->pos = nk_vec2(x, *nxt);
 		client->dim = nk_vec2(w, h);
 
-		char *client_uuid_str = jack_get_uuid_for_client_name(app->client, client_name);
+		// hosted units have no uuid nor metadata, their positions are kept locally
+		char *client_uuid_str = hosted
+			? NULL
+			: jack_get_uuid_for_client_name(app->client, client_name);
 		if(client_uuid_str)
 		{
 			jack_uuid_parse(client_uuid_str, &client->uuid);
@@ -99,33 +262,34 @@ _client_add(app_t *app, const char *client_name, int client_flags)
 		}
 
 #ifdef JACK_HAS_METADATA_API
+		if(!jack_uuid_empty(client->uuid))
 		{
-			char *value = NULL;
-			char *type = NULL;
-			jack_get_property(client->uuid, JACK_METADATA_PRETTY_NAME, &value, &type);
-			if(value)
+			jack_description_t tmp;
+			const jack_description_t *desc = _description_get(app, client->uuid, &tmp);
+
 			{
-				client->pretty_name = strdup(value);
-				jack_free(value);
+				const char *value = _description_value(desc, JACK_METADATA_PRETTY_NAME);
+				if(value)
+					client->pretty_name = strdup(value);
 			}
-			if(type)
-				jack_free(type);
-		}
 
-		if(client->flags == (JackPortIsInput | JackPortIsOutput) )
-		{
-			_client_get_or_set_pos_x(app, client, PATCHMATRIX__mainPositionX);
-			_client_get_or_set_pos_y(app, client, PATCHMATRIX__mainPositionY);
-		}
-		else if(client->flags == JackPortIsInput)
-		{
-			_client_get_or_set_pos_x(app, client, PATCHMATRIX__sinkPositionX);
-			_client_get_or_set_pos_y(app, client, PATCHMATRIX__sinkPositionY);
-		}
-		else if(client->flags == JackPortIsOutput)
-		{
-			_client_get_or_set_pos_x(app, client, PATCHMATRIX__sourcePositionX);
-			_client_get_or_set_pos_y(app, client, PATCHMATRIX__sourcePositionY);
+			if(client->flags == (JackPortIsInput | JackPortIsOutput) )
+			{
+				_client_get_or_set_pos_x(app, client, desc, PATCHMATRIX__mainPositionX);
+				_client_get_or_set_pos_y(app, client, desc, PATCHMATRIX__mainPositionY);
+			}
+			else if(client->flags == JackPortIsInput)
+			{
+				_client_get_or_set_pos_x(app, client, desc, PATCHMATRIX__sinkPositionX);
+				_client_get_or_set_pos_y(app, client, desc, PATCHMATRIX__sinkPositionY);
+			}
+			else if(client->flags == JackPortIsOutput)
+			{
+				_client_get_or_set_pos_x(app, client, desc, PATCHMATRIX__sourcePositionX);
+				_client_get_or_set_pos_y(app, client, desc, PATCHMATRIX__sourcePositionY);
+			}
+
+			_description_put(app, desc, &tmp);
 		}
 #endif
 
@@ -135,6 +299,12 @@ _client_add(app_t *app, const char *client_name, int client_flags)
 			client->mixer_shm = _mixer_add(client_name);
 
 		_hash_add(&app->clients, client);
+		app->spatial.dirty = true;
+		_index_add(&app->client_names, _index_key_str(client->name), client);
+#ifdef JACK_HAS_METADATA_API
+		if(!jack_uuid_empty(client->uuid))
+			_index_add(&app->client_uuids, _index_key_uuid(client->uuid), client);
+#endif
 	}
 
 	return client;
@@ -179,19 +349,58 @@ _client_remove_cb(void *node, void *data)
 	return true;
 }
 
+static void
+_port_unindex(app_t *app, port_t *port)
+{
+	_index_remove(&app->port_names, _index_key_str(port->name), port);
+	_index_remove(&app->port_bodies, _index_key_ptr(port->body), port);
+#ifdef JACK_HAS_METADATA_API
+	_index_remove(&app->port_uuids, _index_key_uuid(port->uuid), port);
+#endif
+}
+
 void
 _client_remove(app_t *app, client_t *client)
 {
 	_hash_remove(&app->clients, client);
+	if(client->dirty)
+		_hash_remove(&app->dirty_clients, client);
+	_hash_remove(&app->spatial.visible, client);
+	app->spatial.dirty = true;
+	_index_remove(&app->client_names, _index_key_str(client->name), client);
+#ifdef JACK_HAS_METADATA_API
+	if(!jack_uuid_empty(client->uuid))
+		_index_remove(&app->client_uuids, _index_key_uuid(client->uuid), client);
+#endif
+
+	HASH_FOREACH(&client->ports, port_itr)
+	{
+		port_t *port = *port_itr;
+
+		_port_unindex(app, port);
+	}
+
+	HASH_FOREACH(&app->conns, client_conn_itr)
+	{
+		client_conn_t *client_conn = *client_conn_itr;
+
+		if(  (client_conn->source_client == client)
+			|| (client_conn->sink_client == client) )
+		{
+			_index_remove(&app->client_conns, _index_key_ptr2(client_conn->source_client,
+				client_conn->sink_client), client_conn);
+		}
+	}
+
 	_hash_remove_cb(&app->conns, _client_remove_cb, client);
 }
 
 client_t *
 _client_find_by_name(app_t *app, const char *client_name, int client_flags)
 {
-	HASH_FOREACH(&app->clients, client_itr)
+	INDEX_FOREACH(&app->client_names, _index_key_str(client_name), client_itr)
 	{
-		client_t *client = *client_itr;
+		client_t *client = client_itr->node;
 
 		if(!strcmp(client->name, client_name) && (client->flags == client_flags))
 		{
@@ -206,9 +415,12 @@ _client_find_by_name(app_t *app, const char *client_name, int client_flags)
 client_t *
 _client_find_by_uuid(app_t *app, jack_uuid_t client_uuid, int client_flags)
 {
-	HASH_FOREACH(&app->clients, client_itr)
+	if(jack_uuid_empty(client_uuid)) // hosted units and clients gone
+		return NULL;
+
+	INDEX_FOREACH(&app->client_uuids, _index_key_uuid(client_uuid), client_itr)
 	{
-		client_t *client = *client_itr;
+		client_t *client = client_itr->node;
 
 		if(!jack_uuid_compare(client->uuid, client_uuid) && (client->flags == client_flags))
 		{
@@ -236,27 +448,6 @@ _client_find_port_by_name(client_t *client, const char *port_name)
 	return NULL;
 }
 
-void
-_client_refresh_type(client_t *client)
-{
-	client->source_type = TYPE_NONE;
-	client->sink_type = TYPE_NONE;
-
-	HASH_FOREACH(&client->sources, port_itr)
-	{
-		port_t *port = *port_itr;
-
-		client->source_type |= port->type;
-	}
-
-	HASH_FOREACH(&client->sinks, port_itr)
-	{
-		port_t *port = *port_itr;
-
-		client->sink_type |= port->type;
-	}
-}
-
 static int
 strcasenumcmp(const char *s1, const char *s2)
 {
@@ -310,11 +501,70 @@ _client_port_sort(const void *a, const void *b)
 	return strcasenumcmp(port_a->name, port_b->name); // order according to name
 }
 
+static void
+_client_reindex(hash_t *ports)
+{
+	unsigned index = 0;
+
+	HASH_FOREACH(ports, port_itr)
+	{
+		port_t *port = *port_itr;
+
+		if(port->index != index)
+		{
+			port->index = index;
+
+			// matrix cells of this port have moved
+			HASH_FOREACH(&port->conns, port_conn_itr)
+			{
+				port_conn_t *port_conn = *port_conn_itr;
+
+				port_conn->client_conn->stale = true;
+			}
+		}
+
+		index++;
+	}
+}
+
 void
 _client_sort(client_t *client)
 {
 	_hash_sort(&client->sources, _client_port_sort);
 	_hash_sort(&client->sinks, _client_port_sort);
+	_client_reindex(&client->sources);
+	_client_reindex(&client->sinks);
+}
+
+void
+_client_dirty(app_t *app, client_t *client, client_dirty_t dirty)
+{
+	if(!client->dirty)
+		_hash_add(&app->dirty_clients, client);
+
+	client->dirty |= dirty;
+}
+
+void
+_client_flush(app_t *app)
+{
+	if(_hash_empty(&app->dirty_clients))
+		return;
+
+	HASH_FOREACH(&app->dirty_clients, client_itr)
+	{
+		client_t *client = *client_itr;
+
+		if(client->dirty & DIRTY_SORT)
+			_client_sort(client);
+	}
+
+	HASH_FREE(&app->dirty_clients, client_ptr)
+	{
+		client_t *client = client_ptr;
+
+		client->dirty = DIRTY_NONE;
+	}
 }
 
 // client connection
@@ -331,13 +581,24 @@ _client_conn_add(app_t *app, client_t *source_client, client_t *sink_client)
 			(source_client->pos.x + sink_client->pos.x)/2,
 			(source_client->pos.y + sink_client->pos.y)/2);
 		client_conn->type = TYPE_NONE;
+		client_conn->stale = true;
 
 		_hash_add(&app->conns, client_conn);
+		app->spatial.dirty = true;
+		_index_add(&app->client_conns, _index_key_ptr2(source_client, sink_client),
+			client_conn);
 	}
 
 	return client_conn;
 }
 
+static void
+_port_conn_detach(port_conn_t *port_conn)
+{
+	_hash_remove(&port_conn->source_port->conns, port_conn);
+	_hash_remove(&port_conn->sink_port->conns, port_conn);
+}
+
 void
 _client_conn_free(client_conn_t *client_conn)
 {
@@ -345,9 +606,11 @@ _client_conn_free(client_conn_t *client_conn)
 	{
 		port_conn_t *port_conn = port_conn_ptr;
 
+		_port_conn_detach(port_conn);
 		_port_conn_free(port_conn);
 	}
 
+	free(client_conn->bitmap);
 	free(client_conn);
 }
 
@@ -355,15 +618,19 @@ void
 _client_conn_remove(app_t *app, client_conn_t *client_conn)
 {
 	_hash_remove(&app->conns, client_conn);
+	app->spatial.dirty = true;
+	_index_remove(&app->client_conns, _index_key_ptr2(client_conn->source_client,
+		client_conn->sink_client), client_conn);
 	_client_conn_free(client_conn);
 }
 
 client_conn_t *
 _client_conn_find(app_t *app, client_t *source_client, client_t *sink_client)
 {
-	HASH_FOREACH(&app->conns, client_conn_itr)
+	INDEX_FOREACH(&app->client_conns, _index_key_ptr2(source_client, sink_client),
+		client_conn_itr)
 	{
-		client_conn_t *client_conn = *client_conn_itr;
+		client_conn_t *client_conn = client_conn_itr->node;
 
 		if(  (client_conn->source_client == source_client)
 			&& (client_conn->sink_client == sink_client) )
@@ -385,18 +652,76 @@ _client_conn_find_or_add(app_t *app, client_t *source_client, client_t *sink_cli
 	return client_conn;
 }
 
-void
-_client_conn_refresh_type(client_conn_t *client_conn)
+static bool
+_client_conn_cell(client_conn_t *client_conn, port_t *source_port, port_t *sink_port,
+	uint32_t **word, uint32_t *mask)
 {
-	client_conn->type = TYPE_NONE;
+	if(  (source_port->index >= client_conn->rows)
+		|| (sink_port->index >= client_conn->stride*32) )
+	{
+		return false;
+	}
+
+	*word = &client_conn->bitmap[source_port->index*client_conn->stride + sink_port->index/32];
+	*mask = 1U << (sink_port->index % 32);
+
+	return true;
+}
+
+static void
+_client_conn_rebuild(client_conn_t *client_conn)
+{
+	const unsigned rows = _hash_size(&client_conn->source_client->sources);
+	const unsigned stride = (_hash_size(&client_conn->sink_client->sinks) + 31) / 32;
+	const unsigned size = rows * stride;
+
+	if(size > client_conn->capacity)
+	{
+		uint32_t *bitmap = realloc(client_conn->bitmap, size*sizeof(uint32_t));
+		if(!bitmap)
+			return; // stays stale, lookups fall back to _port_conn_find
+
+		client_conn->bitmap = bitmap;
+		client_conn->capacity = size;
+	}
+
+	client_conn->rows = rows;
+	client_conn->stride = stride;
+	if(size)
+		memset(client_conn->bitmap, 0x0, size*sizeof(uint32_t));
 
 	HASH_FOREACH(&client_conn->conns, port_conn_itr)
 	{
 		port_conn_t *port_conn = *port_conn_itr;
+		uint32_t *word;
+		uint32_t mask;
 
-		client_conn->type |= port_conn->source_port->type;
-		client_conn->type |= port_conn->sink_port->type;
+		if(_client_conn_cell(client_conn, port_conn->source_port, port_conn->sink_port,
+			&word, &mask))
+		{
+			*word |= mask;
+		}
 	}
+
+	client_conn->stale = false;
+}
+
+bool
+_client_conn_test(client_conn_t *client_conn, port_t *source_port, port_t *sink_port)
+{
+	if(client_conn->stale)
+		_client_conn_rebuild(client_conn);
+
+	if(client_conn->stale)
+		return _port_conn_find(client_conn, source_port, sink_port) != NULL;
+
+	uint32_t *word;
+	uint32_t mask;
+
+	if(!_client_conn_cell(client_conn, source_port, sink_port, &word, &mask))
+		return false;
+
+	return *word & mask;
 }
 
 // port connection
@@ -409,10 +734,23 @@ _port_conn_add(client_conn_t *client_conn, port_t *source_port, port_t *sink_por
 	{
 		port_conn->source_port = source_port;
 		port_conn->sink_port = sink_port;
+		port_conn->client_conn = client_conn;
 		_hash_add(&client_conn->conns, port_conn);
+		_hash_add(&source_port->conns, port_conn);
+		_hash_add(&sink_port->conns, port_conn);
+
+		_type_ref(client_conn->type_refs, &client_conn->type, _port_conn_type(port_conn));
 
-		client_conn->type |= source_port->type | sink_port->type;
-		_client_conn_refresh_type(client_conn);
+		if(!client_conn->stale)
+		{
+			uint32_t *word;
+			uint32_t mask;
+
+			if(_client_conn_cell(client_conn, source_port, sink_port, &word, &mask))
+				*word |= mask;
+			else // matrix has grown
+				client_conn->stale = true;
+		}
 	}
 
 	return port_conn;
@@ -450,7 +788,19 @@ _port_conn_remove_cb(void *node, void *data)
 	if(  (dst->source_port == ref->source_port)
 		&& (dst->sink_port == ref->sink_port) )
 	{
-		free(dst);
+		client_conn_t *client_conn = dst->client_conn;
+
+		_type_unref(client_conn->type_refs, &client_conn->type, _port_conn_type(dst));
+		if(!client_conn->stale)
+		{
+			uint32_t *word;
+			uint32_t mask;
+
+			if(_client_conn_cell(client_conn, dst->source_port, dst->sink_port, &word, &mask))
+				*word &= ~mask;
+		}
+		_port_conn_detach(dst);
+		_port_conn_free(dst);
 		return false;
 	}
 
@@ -462,11 +812,11 @@ _port_conn_remove(app_t *app, client_conn_t *client_conn, port_t *source_port, p
 {
 	port_conn_t port_conn = {
 		.source_port = source_port,
-		.sink_port = sink_port
+		.sink_port = sink_port,
+		.client_conn = client_conn
 	};
 
 	_hash_remove_cb(&client_conn->conns, _port_conn_remove_cb, &port_conn);
-	_client_conn_refresh_type(client_conn);
 
 	if(_hash_size(&client_conn->conns) == 0)
 		_client_conn_remove(app, client_conn);
@@ -497,9 +847,22 @@ _port_add(app_t *app, jack_port_t *jport)
 	if(!client_name)
 		return NULL;
 
+	// units hosted by engine show up as clients of their own
+	const char *unit_sep = strrchr(port_short_name, '/');
+	const bool hosted = !strcmp(client_name, PATCHMATRIX_ENGINE_ID) && unit_sep;
+	if(hosted)
+	{
+		free(client_name);
+		client_name = strndup(port_short_name, unit_sep - port_short_name);
+		if(!client_name)
+			return NULL;
+
+		port_short_name = unit_sep + 1;
+	}
+
 	client_t *client = _client_find_by_name(app, client_name, client_flags);
 	if(!client)
-		client = _client_add(app, client_name, client_flags);
+		client = _client_add(app, client_name, client_flags, hosted);
 	free(client_name);
 	if(!client)
 		return NULL;
@@ -512,86 +875,72 @@ _port_add(app_t *app, jack_port_t *jport)
 		port->uuid = jack_port_uuid(jport);
 		port->name = strdup(port_name);
 		port->short_name = strdup(port_short_name);
+		port->is_input = is_input;
 		port->type = port_type;
 		port->designation = DESIGNATION_NONE;
 
 #ifdef JACK_HAS_METADATA_API
+		jack_description_t tmp;
+		const jack_description_t *desc = _description_get(app, port->uuid, &tmp);
+
 		{
-			char *value = NULL;
-			char *type = NULL;
-			jack_get_property(port->uuid, JACKEY_SIGNAL_TYPE, &value, &type);
+			const char *value = _description_value(desc, JACKEY_SIGNAL_TYPE);
 			if(value)
 			{
 				if(!strcasecmp(value, port_labels[TYPE_CV]))
 					port->type = TYPE_CV;
-				jack_free(value);
 			}
-			if(type)
-				jack_free(type);
 		}
 		{
-			char *value = NULL;
-			char *type = NULL;
-			jack_get_property(port->uuid, JACKEY_EVENT_TYPES, &value, &type);
+			const char *value = _description_value(desc, JACKEY_EVENT_TYPES);
 			if(value)
 			{
 				if(strcasestr(value, port_labels[TYPE_MIDI]))
 					port->type |= TYPE_MIDI;
 				if(strcasestr(value, port_labels[TYPE_OSC]))
 					port->type |= TYPE_OSC;
-				jack_free(value);
 			}
-			if(type)
-				jack_free(type);
 		}
 		{
-			char *value = NULL;
-			char *type = NULL;
-			jack_get_property(port->uuid, JACKEY_ORDER, &value, &type);
+			const char *value = _description_value(desc, JACKEY_ORDER);
 			if(value)
-			{
 				port->order = atoi(value);
-				jack_free(value);
-			}
-			if(type)
-				jack_free(type);
 		}
 		{
-			char *value = NULL;
-			char *type = NULL;
-			jack_get_property(port->uuid, JACK_METADATA_PORT_GROUP, &value, &type);
+			const char *value = _description_value(desc, JACK_METADATA_PORT_GROUP);
 			if(value)
-			{
 				port->designation = _designation_get(value);
-				jack_free(value);
-			}
-			if(type)
-				jack_free(type);
 		}
 		{
-			char *value = NULL;
-			char *type = NULL;
-			jack_get_property(port->uuid, JACK_METADATA_PRETTY_NAME, &value, &type);
+			const char *value = _description_value(desc, JACK_METADATA_PRETTY_NAME);
 			if(value)
-			{
 				port->pretty_name = strdup(value);
-				jack_free(value);
-			}
-			if(type)
-				jack_free(type);
 		}
+
+		_description_put(app, desc, &tmp);
 #endif
 
 		if(port->type == TYPE_NONE)
 			port->type |= TYPE_MIDI; // fallback, if none defined
 
 		_hash_add(&client->ports, port);
+		_index_add(&app->port_names, _index_key_str(port->name), port);
+		_index_add(&app->port_bodies, _index_key_ptr(port->body), port);
+#ifdef JACK_HAS_METADATA_API
+		_index_add(&app->port_uuids, _index_key_uuid(port->uuid), port);
+#endif
 		if(is_input)
+		{
+			port->index = _hash_size(&client->sinks);
 			_hash_add(&client->sinks, port);
+		}
 		else
+		{
+			port->index = _hash_size(&client->sources);
 			_hash_add(&client->sources, port);
-		_client_sort(client);
-		_client_refresh_type(client);
+		}
+		_client_type_ref(port);
+		_client_dirty(app, client, DIRTY_SORT);
 	}
 
 	return port;
@@ -603,75 +952,101 @@ _port_free(port_t *port)
 	free(port->name);
 	free(port->short_name);
 	free(port->pretty_name);
+	_hash_free(&port->conns);
 	free(port);
 }
 
-static bool
-_port_remove_cb_cb(void *node, void *data)
+void
+_port_remove(app_t *app, port_t *port)
 {
-	port_conn_t *port_conn = node;
-	port_t *port = data;
+	client_t *client = port->client;
 
-	if(  (port_conn->source_port == port)
-		|| (port_conn->sink_port == port) )
+	_hash_remove(&client->ports, port);
+	_hash_remove(&client->sinks, port);
+	_hash_remove(&client->sources, port);
+	_port_unindex(app, port);
+	_client_type_unref(port);
+
+	// only visit connections of this very port
+	HASH_FREE(&port->conns, port_conn_ptr)
 	{
+		port_conn_t *port_conn = port_conn_ptr;
+		client_conn_t *client_conn = port_conn->client_conn;
+		port_t *peer = (port_conn->source_port == port)
+			? port_conn->sink_port
+			: port_conn->source_port;
+
+		_type_unref(client_conn->type_refs, &client_conn->type, _port_conn_type(port_conn));
+		_hash_remove(&peer->conns, port_conn);
+		_hash_remove(&client_conn->conns, port_conn);
 		_port_conn_free(port_conn);
-		return false;
+		client_conn->stale = true;
+
+		// free when empty
+		if(_hash_empty(&client_conn->conns))
+			_client_conn_remove(app, client_conn);
 	}
 
-	return true;
+	// close the gap left in the matrix rows or columns
+	_client_reindex(port->is_input ? &client->sinks : &client->sources);
 }
 
-static bool
-_port_remove_cb(void *node, void *data)
+void
+_port_set_type(app_t *app, port_t *port, port_type_t port_type)
 {
-	client_conn_t *client_conn = node;
-	port_t *port = data;
+	if(port->type == port_type)
+		return;
 
-	if(  (client_conn->source_client == port->client)
-		|| (client_conn->sink_client == port->client) )
+	_client_type_unref(port);
+	HASH_FOREACH(&port->conns, port_conn_itr)
 	{
-		_hash_remove_cb(&client_conn->conns, _port_remove_cb_cb, port);
-		_client_conn_refresh_type(client_conn);
+		port_conn_t *port_conn = *port_conn_itr;
+		client_conn_t *client_conn = port_conn->client_conn;
+
+		_type_unref(client_conn->type_refs, &client_conn->type, _port_conn_type(port_conn));
 	}
 
-	// free when empty
-	if(_hash_size(&client_conn->conns) == 0)
+	port->type = port_type;
+
+	_client_type_ref(port);
+	HASH_FOREACH(&port->conns, port_conn_itr)
 	{
-		_client_conn_free(client_conn);
-		return false;
-	}
+		port_conn_t *port_conn = *port_conn_itr;
+		client_conn_t *client_conn = port_conn->client_conn;
 
-	return true;
+		_type_ref(client_conn->type_refs, &client_conn->type, _port_conn_type(port_conn));
+	}
 }
 
 void
-_port_remove(app_t *app, port_t *port)
+_port_rename(app_t *app, port_t *port, const char *port_name)
 {
-	client_t *client = port->client;
+	const char *sep = strchr(port_name, ':');
+	if(!sep)
+		return;
 
-	_hash_remove(&client->ports, port);
-	_hash_remove(&client->sinks, port);
-	_hash_remove(&client->sources, port);
-	_hash_remove_cb(&app->conns, _port_remove_cb, port);
-	_client_refresh_type(client);
+	_index_remove(&app->port_names, _index_key_str(port->name), port);
+
+	free(port->name);
+	free(port->short_name);
+
+	port->name = strdup(port_name);
+	port->short_name = strdup(sep + 1);
+
+	if(port->name)
+		_index_add(&app->port_names, _index_key_str(port->name), port);
 }
 
 port_t *
 _port_find_by_name(app_t *app, const char *port_name)
 {
-	HASH_FOREACH(&app->clients, client_itr)
+	INDEX_FOREACH(&app->port_names, _index_key_str(port_name), port_itr)
 	{
-		client_t *client = *client_itr;
+		port_t *port = port_itr->node;
 
-		HASH_FOREACH(&client->ports, port_itr)
+		if(!strcmp(port->name, port_name))
 		{
-			port_t *port = *port_itr;
-
-			if(!strcmp(port->name, port_name))
-			{
-				return port;
-			}
+			return port;
 		}
 	}
 
@@ -682,18 +1057,13 @@ _port_find_by_name(app_t *app, const char *port_name)
 port_t *
 _port_find_by_uuid(app_t *app, jack_uuid_t port_uuid)
 {
-	HASH_FOREACH(&app->clients, client_itr)
+	INDEX_FOREACH(&app->port_uuids, _index_key_uuid(port_uuid), port_itr)
 	{
-		client_t *client = *client_itr;
+		port_t *port = port_itr->node;
 
-		HASH_FOREACH(&client->ports, port_itr)
+		if(!jack_uuid_compare(port->uuid, port_uuid))
 		{
-			port_t *port = *port_itr;
-
-			if(!jack_uuid_compare(port->uuid, port_uuid))
-			{
-				return port;
-			}
+			return port;
 		}
 	}
 
@@ -704,33 +1074,206 @@ _port_find_by_uuid(app_t *app, jack_uuid_t port_uuid)
 port_t *
 _port_find_by_body(app_t *app, jack_port_t *body)
 {
-	HASH_FOREACH(&app->clients, client_itr)
+	INDEX_FOREACH(&app->port_bodies, _index_key_ptr(body), port_itr)
 	{
-		client_t *client = *client_itr;
+		port_t *port = port_itr->node;
 
-		HASH_FOREACH(&client->ports, port_itr)
+		if(port->body == body)
 		{
-			port_t *port = *port_itr;
-
-			if(port->body == body)
-			{
-				return port;
-			}
+			return port;
 		}
 	}
 
 	return NULL;
 }
 
+// map a shm segment at exactly the size its header reports
+static void *
+_shm_map(const char *client_name, size_t min_size)
+{
+	const int fd = shm_open(client_name, O_RDWR, S_IRUSR | S_IWUSR);
+	if(fd == -1)
+		return NULL;
+
+	struct stat st;
+	if( (fstat(fd, &st) == -1) || ((size_t)st.st_size < min_size) )
+	{
+		close(fd);
+		return NULL;
+	}
+
+	shm_hdr_t *hdr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(hdr == MAP_FAILED)
+		return NULL;
+
+	// reject segments not yet initialized or of a different layout
+	if(  (atomic_load_explicit(&hdr->version, memory_order_acquire) != SHM_VERSION)
+		|| (hdr->size != (size_t)st.st_size) )
+	{
+		munmap(hdr, st.st_size);
+		return NULL;
+	}
+
+	return hdr;
+}
+
+// engine
+static bool
+_engine_running(app_t *app)
+{
+	// shm may outlive a crashed engine, its JACK client does not
+	char *client_uuid_str = jack_get_uuid_for_client_name(app->client, PATCHMATRIX_ENGINE_ID);
+	if(!client_uuid_str)
+		return false;
+
+	jack_free(client_uuid_str);
+
+	return true;
+}
+
+void
+_engine_spawn(app_t *app)
+{
+	if(_engine_running(app))
+		return;
+
+	pid_t pid = vfork();
+	if(pid == 0) // child
+	{
+		char *const argv [] = {
+			PATCHMATRIX_ENGINE,
+			app->server_name ? "-n" : NULL,
+			(char *)app->server_name,
+			NULL
+		};
+
+		execvp(argv[0], argv);
+		_exit(-errno);
+	}
+}
+
+static bool
+_engine_cmd_push(app_t *app, const engine_cmd_t *cmd)
+{
+	if(!_engine_running(app))
+		return false;
+
+	char shm_name [ENGINE_SHM_NAME_SIZE];
+	_engine_shm_name(shm_name, app->server_name);
+
+	// map anew each time, engine may have been restarted in between
+	engine_shm_t *engine_shm = _shm_map(shm_name, sizeof(engine_shm_t));
+	if(!engine_shm)
+		return false;
+
+	if(engine_shm->ring != _engine_shm_ring_offset())
+	{
+		munmap(engine_shm, engine_shm->hdr.size);
+		return false;
+	}
+
+	varchunk_t *ring = _engine_shm_ring(engine_shm);
+	bool pushed = false;
+
+	// there may be multiple UIs, but the ring has a single producer
+	if(atomic_exchange_explicit(&engine_shm->locked, true, memory_order_acquire))
+	{
+		munmap(engine_shm, engine_shm->hdr.size);
+		return false;
+	}
+
+	engine_cmd_t *dst;
+	if((dst = varchunk_write_request(ring, sizeof(engine_cmd_t))))
+	{
+		*dst = *cmd;
+		varchunk_write_advance(ring, sizeof(engine_cmd_t));
+		pushed = true;
+	}
+
+	atomic_store_explicit(&engine_shm->locked, false, memory_order_release);
+
+	if(pushed)
+		sem_post(&engine_shm->wake);
+
+	munmap(engine_shm, engine_shm->hdr.size);
+
+	return pushed;
+}
+
+// mixer spawn server
+void
+_zygote_spawn(app_t *app)
+{
+	// exits right away if there already is one for this JACK server
+	pid_t pid = vfork();
+	if(pid == 0) // child
+	{
+		char *const argv [] = {
+			PATCHMATRIX_MIXER,
+			"-z",
+			app->server_name ? "-n" : NULL,
+			(char *)app->server_name,
+			NULL
+		};
+
+		execvp(argv[0], argv);
+		_exit(-errno);
+	}
+}
+
+static bool
+_zygote_req_push(app_t *app, const zygote_req_t *req)
+{
+	struct sockaddr_un addr;
+	_zygote_addr(&addr, app->server_name);
+
+	if(!_runtime_addr_owned(&addr))
+		return false;
+
+	const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(fd == -1)
+		return false;
+
+	// request waits in backlog until next warm mixer accepts, never blocks UI
+	const bool pushed = (connect(fd, (const struct sockaddr *)&addr, sizeof(addr)) == 0)
+		&& (send(fd, req, sizeof(zygote_req_t), MSG_NOSIGNAL) == sizeof(zygote_req_t));
+	close(fd);
+
+	return pushed;
+}
+
 // mixer
 void
 _mixer_spawn(app_t *app, unsigned nsinks, unsigned nsources)
 {
+	const engine_cmd_t cmd = {
+		.type = ENGINE_CMD_MIXER,
+		.port_type = app->type,
+		.nsinks = nsinks,
+		.nsources = nsources
+	};
+
+	// fall back to a process of its own while engine is not (yet) up
+	if(app->engine && _engine_cmd_push(app, &cmd))
+		return;
+
+	const zygote_req_t req = {
+		.port_type = app->type,
+		.nsinks = nsinks,
+		.nsources = nsources
+	};
+
+	// same for spawn server
+	if(app->zygote && _zygote_req_push(app, &req))
+		return;
+
 	pid_t pid = vfork();
 	if(pid == 0) // child
 	{
 		char sink_nums[32];
-		snprintf(sink_nums, 32, "%u", nsources);
+		snprintf(sink_nums, 32, "%u", nsinks);
 
 		char source_nums [32];
 		snprintf(source_nums, 32, "%u", nsources);
@@ -756,20 +1299,16 @@ _mixer_spawn(app_t *app, unsigned nsinks, unsigned nsources)
 mixer_shm_t *
 _mixer_add(const char *client_name)
 {
-	const size_t total_size = sizeof(mixer_shm_t);
-
-	const int fd = shm_open(client_name, O_RDWR, S_IRUSR | S_IWUSR);
-	if(fd == -1)
+	mixer_shm_t *mixer_shm = _shm_map(client_name, sizeof(mixer_shm_t));
+	if(!mixer_shm)
 		return NULL;
 
-	mixer_shm_t *mixer_shm;
-	if(  (ftruncate(fd, total_size) == -1)
-		|| ((mixer_shm = mmap(NULL, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) )
+	if(  (mixer_shm->hdr.size != _mixer_shm_size(mixer_shm->nsinks, mixer_shm->nsources))
+		|| (mixer_shm->ring != _mixer_shm_ring_offset(mixer_shm->nsinks, mixer_shm->nsources)) )
 	{
-		close(fd);
+		_mixer_free(mixer_shm);
 		return NULL;
 	}
-	close(fd);
 
 	return mixer_shm;
 }
@@ -777,15 +1316,82 @@ _mixer_add(const char *client_name)
 void
 _mixer_free(mixer_shm_t *mixer_shm)
 {
-	const size_t total_size = sizeof(mixer_shm_t);
+	munmap(mixer_shm, mixer_shm->hdr.size);
+}
+
+static bool
+_mixer_cmd_push(mixer_shm_t *mixer_shm, const mixer_cmd_t *cmd)
+{
+	varchunk_t *ring = _mixer_shm_ring(mixer_shm);
+	bool pushed = false;
+
+	// there may be multiple UIs, but the ring has a single producer
+	if(atomic_exchange_explicit(&mixer_shm->locked, true, memory_order_acquire))
+		return false;
+
+	mixer_cmd_t *dst;
+	if((dst = varchunk_write_request(ring, sizeof(mixer_cmd_t))))
+	{
+		*dst = *cmd;
+		varchunk_write_advance(ring, sizeof(mixer_cmd_t));
+		pushed = true;
+	}
+
+	atomic_store_explicit(&mixer_shm->locked, false, memory_order_release);
+
+	return pushed;
+}
+
+void
+_mixer_gain_request(mixer_shm_t *mixer_shm, unsigned j, unsigned i, int32_t mBFS)
+{
+	const mixer_cmd_t cmd = {
+		.type = MIXER_CMD_GAIN,
+		.gain = {
+			.source = j,
+			.sink = i,
+			.mBFS = mBFS
+		}
+	};
+
+	// update mirror right away, so consecutive edits accumulate
+	atomic_store_explicit(_mixer_shm_gain(mixer_shm, j, i), mBFS, memory_order_relaxed);
+
+	if(!_mixer_cmd_push(mixer_shm, &cmd)) // ring full or busy, rederive from mirror
+		atomic_store_explicit(&mixer_shm->resync, true, memory_order_release);
 
-	munmap(mixer_shm, total_size);
+	atomic_fetch_add_explicit(&mixer_shm->seq, 1, memory_order_release);
+}
+
+bool
+_mixer_ramp_request(mixer_shm_t *mixer_shm, uint32_t ms)
+{
+	const mixer_cmd_t cmd = {
+		.type = MIXER_CMD_RAMP,
+		.ramp = {
+			.ms = ms
+		}
+	};
+
+	// not mirrored, thus cannot be resynced, caller has to retry
+	return _mixer_cmd_push(mixer_shm, &cmd);
 }
 
 // monitor
 void
-_monitor_spawn(app_t *app, unsigned nsinks)
+_monitor_spawn(app_t *app, unsigned nsinks, monitor_mode_t mode)
 {
+	const engine_cmd_t cmd = {
+		.type = ENGINE_CMD_MONITOR,
+		.port_type = app->type,
+		.nsinks = nsinks,
+		.mode = mode
+	};
+
+	// fall back to a process of its own while engine is not (yet) up
+	if(app->engine && _engine_cmd_push(app, &cmd))
+		return;
+
 	pid_t pid = vfork();
 	if(pid == 0) // child
 	{
@@ -798,6 +1404,8 @@ _monitor_spawn(app_t *app, unsigned nsinks)
 			(char *)_port_type_to_string(app->type),
 			"-i",
 			sink_nums,
+			"-m",
+			(char *)_monitor_mode_to_string(mode),
 			app->server_name ? "-n" : NULL,
 			(char *)app->server_name,
 			NULL
@@ -811,20 +1419,15 @@ _monitor_spawn(app_t *app, unsigned nsinks)
 monitor_shm_t *
 _monitor_add(const char *client_name)
 {
-	const size_t total_size = sizeof(monitor_shm_t);
-
-	const int fd = shm_open(client_name, O_RDWR, S_IRUSR | S_IWUSR);
-	if(fd == -1)
+	monitor_shm_t *monitor_shm = _shm_map(client_name, sizeof(monitor_shm_t));
+	if(!monitor_shm)
 		return NULL;
 
-	monitor_shm_t *monitor_shm;
-	if(  (ftruncate(fd, total_size) == -1)
-		|| ((monitor_shm = mmap(NULL, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) )
+	if(monitor_shm->hdr.size != _monitor_shm_size(monitor_shm->nsinks))
 	{
-		close(fd);
+		_monitor_free(monitor_shm);
 		return NULL;
 	}
-	close(fd);
 
 	return monitor_shm;
 }
@@ -832,7 +1435,5 @@ _monitor_add(const char *client_name)
 void
 _monitor_free(monitor_shm_t *monitor_shm)
 {
-	const size_t total_size = sizeof(monitor_shm_t);
-
-	munmap(monitor_shm, total_size);
+	munmap(monitor_shm, monitor_shm->hdr.size);
 }
@@ -0,0 +1,521 @@
+/*
+ * SPDX-FileCopyrightText: Hanspeter Portner <dev@open-music-kontrollers.ch>
+ * SPDX-License-Identifier: Artistic-2.0
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include <patchmatrix/patchmatrix_engine.h>
+
+typedef struct _engine_plan_t engine_plan_t;
+typedef struct _engine_app_t engine_app_t;
+
+// units in order of processing, handed to process callback as a whole
+struct _engine_plan_t {
+	unsigned nunits;
+	unit_t *units [ENGINE_UNIT_MAX];
+};
+
+struct _engine_app_t {
+	jack_client_t *client;
+	engine_shm_t *shm;
+	unit_t units [ENGINE_UNIT_MAX]; // slots, owned by main thread
+	uint8_t deps [ENGINE_UNIT_MAX][ENGINE_UNIT_MAX]; // [b][a] set when a feeds b
+	engine_plan_t plans [2];
+	_Atomic(engine_plan_t *) plan; // the one currently run by process callback
+	atomic_uint cycles; // completed process cycles
+	atomic_bool reorder; // JACK graph has changed
+	unsigned serial; // of last unit added
+};
+
+static engine_app_t engine;
+
+static atomic_bool closed = ATOMIC_VAR_INIT(false);
+
+static void
+_close(engine_app_t *engine)
+{
+	atomic_store_explicit(&closed, true, memory_order_relaxed);
+
+	if(engine->shm)
+		sem_post(&engine->shm->wake);
+}
+
+static void
+_sig_interrupt(int signum)
+{
+	_close(&engine);
+}
+
+static void
+_jack_on_info_shutdown_cb(jack_status_t code, const char *reason, void *arg)
+{
+	engine_app_t *engine = arg;
+
+	_close(engine);
+}
+
+static int
+_engine_graph_order(void *arg)
+{
+	engine_app_t *engine = arg;
+
+	atomic_store_explicit(&engine->reorder, true, memory_order_relaxed);
+	sem_post(&engine->shm->wake);
+
+	return 0;
+}
+
+static int
+_engine_process(jack_nframes_t nframes, void *arg)
+{
+	engine_app_t *engine = arg;
+	const engine_plan_t *plan = atomic_load_explicit(&engine->plan, memory_order_acquire);
+
+	for(unsigned u = 0; u < plan->nunits; u++)
+	{
+		unit_t *unit = plan->units[u];
+
+		unit->process(nframes, unit->data);
+	}
+
+	atomic_fetch_add_explicit(&engine->cycles, 1, memory_order_release);
+
+	return 0;
+}
+
+// units register their ports as unit-name/port-name
+static unit_t *
+_engine_unit_find(engine_app_t *engine, const char *port_name)
+{
+	jack_port_t *jport = jack_port_by_name(engine->client, port_name);
+	if(!jport || !jack_port_is_mine(engine->client, jport))
+		return NULL;
+
+	const char *short_name = jack_port_short_name(jport);
+	const char *sep = strrchr(short_name, '/');
+	if(!sep)
+		return NULL;
+
+	const size_t len = sep - short_name;
+
+	for(unsigned u = 0; u < ENGINE_UNIT_MAX; u++)
+	{
+		unit_t *unit = &engine->units[u];
+
+		if(  unit->data && !strncmp(unit->name, short_name, len)
+			&& (unit->name[len] == '\0') )
+		{
+			return unit;
+		}
+	}
+
+	return NULL;
+}
+
+static inline bool
+_engine_unit_live(const unit_t *unit)
+{
+	return unit->data && !atomic_load_explicit(unit->closing, memory_order_relaxed);
+}
+
+// topological sort along connections between units, so that each one reads
+// what the ones feeding it have written in the same cycle, ties and feedback
+// loops are resolved by slot to keep the order stable
+static void
+_engine_order(engine_app_t *engine, engine_plan_t *plan)
+{
+	unsigned indeg [ENGINE_UNIT_MAX];
+	bool done [ENGINE_UNIT_MAX];
+	unsigned nlive = 0;
+
+	memset(engine->deps, 0x0, sizeof(engine->deps));
+
+	char pattern [ENGINE_NAME_SIZE + 2];
+	snprintf(pattern, sizeof(pattern), "^%s:", jack_get_client_name(engine->client));
+
+	const char **sinks = jack_get_ports(engine->client, pattern, NULL, JackPortIsInput);
+	for(const char **sink_name = sinks; sink_name && *sink_name; sink_name++)
+	{
+		unit_t *sink = _engine_unit_find(engine, *sink_name);
+		if(!sink)
+			continue;
+
+		jack_port_t *jsink = jack_port_by_name(engine->client, *sink_name);
+		const char **sources = jack_port_get_all_connections(engine->client, jsink);
+		for(const char **source_name = sources; source_name && *source_name; source_name++)
+		{
+			unit_t *source = _engine_unit_find(engine, *source_name);
+
+			if(source && (source != sink))
+				engine->deps[sink - engine->units][source - engine->units] = 1;
+		}
+
+		if(sources)
+			jack_free(sources);
+	}
+
+	if(sinks)
+		jack_free(sinks);
+
+	for(unsigned b = 0; b < ENGINE_UNIT_MAX; b++)
+	{
+		done[b] = !_engine_unit_live(&engine->units[b]);
+		indeg[b] = 0;
+
+		if(done[b])
+			continue;
+
+		for(unsigned a = 0; a < ENGINE_UNIT_MAX; a++)
+		{
+			if(engine->deps[b][a] && _engine_unit_live(&engine->units[a]))
+				indeg[b] += 1;
+		}
+
+		nlive += 1;
+	}
+
+	plan->nunits = 0;
+
+	while(plan->nunits < nlive)
+	{
+		unsigned next = ENGINE_UNIT_MAX;
+
+		for(unsigned u = 0; u < ENGINE_UNIT_MAX; u++)
+		{
+			if(!done[u] && !indeg[u])
+			{
+				next = u;
+				break;
+			}
+		}
+
+		for(unsigned u = 0; (next == ENGINE_UNIT_MAX) && (u < ENGINE_UNIT_MAX); u++)
+		{
+			if(!done[u]) // feedback loop, break it up
+				next = u;
+		}
+
+		done[next] = true;
+		plan->units[plan->nunits++] = &engine->units[next];
+
+		for(unsigned b = 0; b < ENGINE_UNIT_MAX; b++)
+		{
+			if(!done[b] && engine->deps[b][next])
+				indeg[b] -= 1;
+		}
+	}
+}
+
+// hand new plan to process callback and wait until it has let go of the old one
+static void
+_engine_publish(engine_app_t *engine)
+{
+	engine_plan_t *plan = atomic_load_explicit(&engine->plan, memory_order_relaxed);
+	engine_plan_t *next = (plan == &engine->plans[0])
+		? &engine->plans[1]
+		: &engine->plans[0];
+
+	_engine_order(engine, next);
+
+	atomic_store_explicit(&engine->plan, next, memory_order_release);
+
+	// a cycle running right now may still be on the old plan
+	const unsigned cycles = atomic_load_explicit(&engine->cycles, memory_order_acquire);
+
+	while(  (atomic_load_explicit(&engine->cycles, memory_order_acquire) == cycles)
+		&& !atomic_load_explicit(&closed, memory_order_relaxed) )
+	{
+		usleep(1000);
+	}
+}
+
+static bool
+_engine_cmd_handle(engine_app_t *engine, const engine_cmd_t *cmd)
+{
+	unit_t *unit = NULL;
+
+	for(unsigned u = 0; u < ENGINE_UNIT_MAX; u++)
+	{
+		if(!engine->units[u].data)
+		{
+			unit = &engine->units[u];
+			break;
+		}
+	}
+
+	if(!unit)
+	{
+		fprintf(stderr, "Engine is full, dropping unit.\n");
+		return false;
+	}
+
+	const unsigned nsinks = (cmd->nsinks < 1) ? 1
+		: (cmd->nsinks > PORT_MAX) ? PORT_MAX
+		: cmd->nsinks;
+	const unsigned nsources = (cmd->nsources < 1) ? 1
+		: (cmd->nsources > PORT_MAX) ? PORT_MAX
+		: cmd->nsources;
+
+	engine->serial += 1;
+
+	switch(cmd->type)
+	{
+		case ENGINE_CMD_MIXER:
+		{
+			snprintf(unit->name, ENGINE_NAME_SIZE, PATCHMATRIX_MIXER_ID".%d.%u",
+				getpid(), engine->serial);
+
+			return _mixer_unit_new(unit, engine->client, cmd->port_type,
+				nsinks, nsources);
+		} break;
+		case ENGINE_CMD_MONITOR:
+		{
+			snprintf(unit->name, ENGINE_NAME_SIZE, PATCHMATRIX_MONITOR_ID".%d.%u",
+				getpid(), engine->serial);
+
+			return _monitor_unit_new(unit, engine->client, cmd->port_type,
+				nsinks, cmd->mode);
+		} break;
+	}
+
+	return false;
+}
+
+static void
+_engine_run(engine_app_t *engine)
+{
+	varchunk_t *ring = _engine_shm_ring(engine->shm);
+
+	while(!atomic_load_explicit(&closed, memory_order_relaxed))
+	{
+		// units closed by UI only post their own semaphore, thus poll for them
+		struct timespec timeout;
+		clock_gettime(CLOCK_REALTIME, &timeout);
+		timeout.tv_nsec += 100000000; // 100 ms
+		if(timeout.tv_nsec >= 1000000000)
+		{
+			timeout.tv_sec += 1;
+			timeout.tv_nsec -= 1000000000;
+		}
+
+		sem_timedwait(&engine->shm->wake, &timeout);
+
+		bool dirty = atomic_exchange_explicit(&engine->reorder, false, memory_order_relaxed);
+		bool retire = false;
+
+		const engine_cmd_t *cmd;
+		size_t size;
+		while((cmd = varchunk_read_request(ring, &size)))
+		{
+			if( (size == sizeof(engine_cmd_t)) && _engine_cmd_handle(engine, cmd) )
+				dirty = true;
+
+			varchunk_read_advance(ring);
+		}
+
+		for(unsigned u = 0; u < ENGINE_UNIT_MAX; u++)
+		{
+			unit_t *unit = &engine->units[u];
+
+			if(unit->data && (sem_trywait(unit->done) == 0))
+			{
+				atomic_store_explicit(unit->closing, true, memory_order_relaxed);
+				retire = true;
+			}
+		}
+
+		if(dirty || retire)
+			_engine_publish(engine);
+
+		for(unsigned u = 0; retire && (u < ENGINE_UNIT_MAX); u++)
+		{
+			unit_t *unit = &engine->units[u];
+
+			if(unit->data && atomic_load_explicit(unit->closing, memory_order_relaxed))
+			{
+				unit->free(unit->data);
+				unit->data = NULL;
+			}
+		}
+	}
+}
+
+// published by an engine that is still alive, or of unknown layout
+static bool
+_engine_shm_in_use(const char *name)
+{
+	const int fd = shm_open(name, O_RDONLY, 0);
+	if(fd == -1)
+		return false;
+
+	bool in_use = true; // when in doubt, leave segment alone
+
+	struct stat st;
+	if( (fstat(fd, &st) == 0) && ((size_t)st.st_size >= sizeof(engine_shm_t)) )
+	{
+		engine_shm_t *shm = mmap(NULL, sizeof(engine_shm_t), PROT_READ, MAP_SHARED, fd, 0);
+		if(shm != MAP_FAILED)
+		{
+			const unsigned version = atomic_load_explicit(&shm->hdr.version, memory_order_acquire);
+
+			in_use = (version != 0)
+				&& ( (version != SHM_VERSION) || (kill(shm->pid, 0) == 0) || (errno == EPERM) );
+
+			munmap(shm, sizeof(engine_shm_t));
+		}
+	}
+
+	close(fd);
+
+	return in_use;
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *server_name = NULL;
+
+	fprintf(stderr,
+		"%s "PATCHMATRIX_VERSION"\n"
+		"Copyright (c) 2016-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)\n"
+		"Released under Artistic License 2.0 by Open Music Kontrollers\n", argv[0]);
+
+	int c;
+	while((c = getopt(argc, argv, "vhn:")) != -1)
+	{
+		switch(c)
+		{
+			case 'v':
+				fprintf(stderr,
+					"--------------------------------------------------------------------\n"
+					"This is free software: you can redistribute it and/or modify\n"
+					"it under the terms of the Artistic License 2.0 as published by\n"
+					"The Perl Foundation.\n"
+					"\n"
+					"This source is distributed in the hope that it will be useful,\n"
+					"but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+					"MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the\n"
+					"Artistic License 2.0 for more details.\n"
+					"\n"
+					"You should have received a copy of the Artistic License 2.0\n"
+					"along the source as a COPYING file. If not, obtain it from\n"
+					"http://www.perlfoundation.org/artistic_license_2_0.\n\n");
+				return 0;
+			case 'h':
+				fprintf(stderr,
+					"--------------------------------------------------------------------\n"
+					"USAGE\n"
+					"   %s [OPTIONS]\n"
+					"\n"
+					"OPTIONS\n"
+					"   [-v]                 print version and full license information\n"
+					"   [-h]                 print usage information\n"
+					"   [-n] server-name     connect to named JACK daemon\n\n"
+					, argv[0]);
+				return 0;
+			case 'n':
+				server_name = optarg;
+				break;
+			case '?':
+				if(optopt == 'n')
+					fprintf(stderr, "Option `-%c' requires an argument.\n", optopt);
+				else if(isprint(optopt))
+					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+				else
+					fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+				return -1;
+			default:
+				return -1;
+		}
+	}
+
+	// a single engine per server, found by UIs under its well-known name
+	jack_options_t opts = JackNullOption | JackNoStartServer | JackUseExactName;
+	if(server_name)
+		opts |= JackServerName;
+
+	jack_status_t status;
+	engine.client = jack_client_open(PATCHMATRIX_ENGINE_ID, opts, &status,
+		server_name ? server_name : NULL);
+	if(!engine.client)
+		return -1;
+
+	char shm_name [ENGINE_SHM_NAME_SIZE];
+	_engine_shm_name(shm_name, server_name);
+
+	// only ever take over segments left behind by a crashed engine
+	int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if( (fd == -1) && (errno == EEXIST) && !_engine_shm_in_use(shm_name)
+		&& (shm_unlink(shm_name) == 0) )
+	{
+		fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	}
+
+	if(fd == -1)
+		fprintf(stderr, "Cannot create shared memory `%s'.\n", shm_name);
+
+	const size_t total_size = _engine_shm_size();
+	if(fd != -1)
+	{
+		if(ftruncate(fd, total_size) != -1)
+		{
+			if((engine.shm = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED, fd, 0)) != MAP_FAILED)
+			{
+				engine.shm->hdr.size = total_size;
+				engine.shm->ring = _engine_shm_ring_offset();
+				engine.shm->pid = getpid();
+
+				atomic_init(&engine.shm->locked, false);
+				varchunk_init(_engine_shm_ring(engine.shm), ENGINE_RING_SIZE, true);
+
+				atomic_init(&engine.plan, &engine.plans[0]);
+				atomic_init(&engine.cycles, 0);
+				atomic_init(&engine.reorder, false);
+
+				if(sem_init(&engine.shm->wake, 1, 0) != -1)
+				{
+					// layout is complete, let UI map it
+					atomic_store_explicit(&engine.shm->hdr.version, SHM_VERSION, memory_order_release);
+
+					signal(SIGINT, _sig_interrupt);
+					signal(SIGTERM, _sig_interrupt);
+
+					jack_on_info_shutdown(engine.client, _jack_on_info_shutdown_cb, &engine);
+					jack_set_process_callback(engine.client, _engine_process, &engine);
+					jack_set_graph_order_callback(engine.client, _engine_graph_order, &engine);
+
+					jack_activate(engine.client);
+
+					_engine_run(&engine);
+
+					jack_deactivate(engine.client);
+
+					for(unsigned u = 0; u < ENGINE_UNIT_MAX; u++)
+					{
+						unit_t *unit = &engine.units[u];
+
+						if(unit->data)
+							unit->free(unit->data);
+					}
+
+					sem_destroy(&engine.shm->wake);
+				}
+
+				munmap(engine.shm, total_size);
+				engine.shm = NULL;
+			}
+		}
+
+		close(fd);
+		shm_unlink(shm_name);
+	}
+
+	jack_client_close(engine.client);
+
+	return 0;
+}
@@ -0,0 +1,704 @@
+/*
+ * SPDX-FileCopyrightText: Hanspeter Portner <dev@open-music-kontrollers.ch>
+ * SPDX-License-Identifier: Artistic-2.0
+ */
+
+#include <sys/wait.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <stdarg.h>
+
+#include <patchmatrix/patchmatrix.h>
+#include <patchmatrix/patchmatrix_db.h>
+#include <patchmatrix/patchmatrix_jack.h>
+#include <patchmatrix/patchmatrix_gain.h>
+
+#define CTRL_MAX 16 // concurrent control connections
+#define CTRL_LINE 1024 // maximal command length, including newline
+#define CTRL_ARGS 8
+#define CTRL_OUT_MAX 0x400000 // maximal pending replies per connection
+
+typedef struct _ctrl_t ctrl_t;
+
+// control connection with its partially received command and pending replies
+struct _ctrl_t {
+	int fd; // -1 for unused slots
+	size_t len;
+	char line [CTRL_LINE];
+	char *out;
+	size_t out_len;
+	size_t out_size;
+	bool overflow; // client does not keep up with replies
+};
+
+static app_t app;
+static ctrl_t ctrls [CTRL_MAX];
+
+static void
+_sig_interrupt(int signum)
+{
+	atomic_store_explicit(&app.done, true, memory_order_release);
+	eventfd_write(app.wake, 1);
+}
+
+static void
+_sig_child(int signum)
+{
+	const pid_t any_child = -1;
+
+	while(waitpid(any_child, 0, WNOHANG) > 0)
+	{
+		// reap zombies
+	}
+}
+
+// returns true once JACK has gone away
+static bool
+_anim(app_t *app)
+{
+	size_t len;
+
+	// _jack_anim has a per-frame budget, but there are no frames to wait for
+	do
+	{
+		if(_jack_anim(app))
+			return true;
+	} while(varchunk_read_request(app->from_jack, &len));
+
+	return false;
+}
+
+__attribute__((format(printf, 2, 3)))
+static void
+_ctrl_printf(ctrl_t *ctrl, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	const int n = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+
+	if( (n < 0) || ctrl->overflow )
+		return;
+
+	const size_t need = ctrl->out_len + n + 1;
+	if(need > CTRL_OUT_MAX)
+	{
+		ctrl->overflow = true;
+		return;
+	}
+
+	if(need > ctrl->out_size)
+	{
+		size_t size = ctrl->out_size ? ctrl->out_size : CTRL_LINE;
+		while(size < need)
+			size <<= 1;
+
+		char *out = realloc(ctrl->out, size);
+		if(!out)
+		{
+			ctrl->overflow = true;
+			return;
+		}
+
+		ctrl->out = out;
+		ctrl->out_size = size;
+	}
+
+	va_start(args, fmt);
+	vsnprintf(&ctrl->out[ctrl->out_len], n + 1, fmt, args);
+	va_end(args);
+
+	ctrl->out_len += n;
+}
+
+// returns false when connection is to be closed
+static bool
+_ctrl_flush(ctrl_t *ctrl)
+{
+	size_t off = 0;
+	bool alive = !ctrl->overflow;
+
+	while(alive && (off < ctrl->out_len))
+	{
+		const ssize_t n = send(ctrl->fd, &ctrl->out[off], ctrl->out_len - off,
+			MSG_NOSIGNAL);
+
+		if(n >= 0)
+			off += n;
+		else if(errno != EINTR)
+			alive = (errno == EAGAIN) || (errno == EWOULDBLOCK); // rest on POLLOUT
+	}
+
+	ctrl->out_len -= off;
+	memmove(ctrl->out, &ctrl->out[off], ctrl->out_len);
+
+	return alive;
+}
+
+static void
+_ctrl_close(ctrl_t *ctrl)
+{
+	close(ctrl->fd);
+	free(ctrl->out);
+
+	ctrl->fd = -1;
+	ctrl->len = 0;
+	ctrl->out = NULL;
+	ctrl->out_len = 0;
+	ctrl->out_size = 0;
+	ctrl->overflow = false;
+}
+
+static void
+_ctrl_status(ctrl_t *ctrl, const char *err)
+{
+	if(err)
+		_ctrl_printf(ctrl, "error %s\n", err);
+	else
+		_ctrl_printf(ctrl, "ok\n");
+}
+
+// split at white space, double quotes group names containing spaces
+static unsigned
+_ctrl_split(char *line, char **argv)
+{
+	unsigned argc = 0;
+	char *p = line;
+
+	while(argc < CTRL_ARGS)
+	{
+		while(isspace(*p))
+			p++;
+
+		if(*p == '\0')
+			break;
+
+		if(*p == '"')
+		{
+			argv[argc++] = ++p;
+
+			while(*p && (*p != '"'))
+				p++;
+		}
+		else
+		{
+			argv[argc++] = p;
+
+			while(*p && !isspace(*p))
+				p++;
+		}
+
+		if(*p)
+			*p++ = '\0';
+	}
+
+	return argc;
+}
+
+static void
+_ctrl_ports(app_t *app, ctrl_t *ctrl)
+{
+	HASH_FOREACH(&app->clients, client_itr)
+	{
+		client_t *client = *client_itr;
+
+		HASH_FOREACH(&client->ports, port_itr)
+		{
+			port_t *port = *port_itr;
+			const char *type = _port_type_to_string(port->type);
+
+			_ctrl_printf(ctrl, "port \"%s\" %s %s\n", port->name,
+				port->is_input ? "in" : "out", type ? type : "NONE");
+		}
+	}
+}
+
+static void
+_ctrl_connections(app_t *app, ctrl_t *ctrl)
+{
+	HASH_FOREACH(&app->conns, client_conn_itr)
+	{
+		client_conn_t *client_conn = *client_conn_itr;
+
+		HASH_FOREACH(&client_conn->conns, port_conn_itr)
+		{
+			port_conn_t *port_conn = *port_conn_itr;
+
+			_ctrl_printf(ctrl, "conn \"%s\" \"%s\"\n", port_conn->source_port->name,
+				port_conn->sink_port->name);
+		}
+	}
+}
+
+static mixer_shm_t *
+_ctrl_mixer_find(app_t *app, const char *client_name)
+{
+	HASH_FOREACH(&app->clients, client_itr)
+	{
+		client_t *client = *client_itr;
+
+		if(client->mixer_shm && !strcmp(client->name, client_name))
+			return client->mixer_shm;
+	}
+
+	return NULL;
+}
+
+static const char *
+_ctrl_gain(app_t *app, char **argv)
+{
+	mixer_shm_t *mixer_shm = _ctrl_mixer_find(app, argv[1]);
+	if(!mixer_shm)
+		return "no such mixer";
+
+	const unsigned source = atoi(argv[2]);
+	const unsigned sink = atoi(argv[3]);
+	if(  (source < 1) || (source > mixer_shm->nsources)
+		|| (sink < 1) || (sink > _mixer_shm_ncols(mixer_shm)) ) // incl. CV offset
+	{
+		return "no such port";
+	}
+
+	int32_t mBFS = atoi(argv[4]);
+	if(mBFS < GAIN_MIN)
+		mBFS = GAIN_MIN;
+	else if(mBFS > GAIN_MAX)
+		mBFS = GAIN_MAX;
+
+	_mixer_gain_request(mixer_shm, source - 1, sink - 1, mBFS);
+
+	return NULL;
+}
+
+static const char *
+_ctrl_ramp(app_t *app, char **argv)
+{
+	mixer_shm_t *mixer_shm = _ctrl_mixer_find(app, argv[1]);
+	if(!mixer_shm)
+		return "no such mixer";
+
+	const int ms = atoi(argv[2]);
+	if( (ms < 0) || (ms > 1000) )
+		return "invalid ramp time";
+
+	if(!_mixer_ramp_request(mixer_shm, ms))
+		return "mixer busy";
+
+	return NULL;
+}
+
+static void
+_ctrl_handle(app_t *app, ctrl_t *ctrl, char *line)
+{
+	char *argv [CTRL_ARGS];
+	const unsigned argc = _ctrl_split(line, argv);
+
+	if(argc == 0)
+		return;
+
+	// answer with graph as of after preceding commands
+	if(_anim(app))
+	{
+		_ctrl_status(ctrl, "JACK has gone away");
+		return;
+	}
+
+	if(!strcmp(argv[0], "ports") && (argc == 1))
+	{
+		_ctrl_ports(app, ctrl);
+		_ctrl_status(ctrl, NULL);
+	}
+	else if(!strcmp(argv[0], "connections") && (argc == 1))
+	{
+		_ctrl_connections(app, ctrl);
+		_ctrl_status(ctrl, NULL);
+	}
+	else if(!strcmp(argv[0], "connect") && (argc == 3))
+	{
+		const int ret = jack_connect(app->client, argv[1], argv[2]);
+
+		_ctrl_status(ctrl, (ret == 0) || (ret == EEXIST) ? NULL : "cannot connect");
+	}
+	else if(!strcmp(argv[0], "disconnect") && (argc == 3))
+	{
+		const int ret = jack_disconnect(app->client, argv[1], argv[2]);
+
+		_ctrl_status(ctrl, (ret == 0) ? NULL : "cannot disconnect");
+	}
+	else if(!strcmp(argv[0], "mixer") && (argc == 4))
+	{
+		const port_type_t type = _port_type_from_string(argv[1]);
+		const int nsinks = atoi(argv[2]);
+		const int nsources = atoi(argv[3]);
+
+		if(  (type == TYPE_NONE)
+			|| (nsinks < 1) || (nsinks > PORT_MAX)
+			|| (nsources < 1) || (nsources > PORT_MAX) )
+		{
+			_ctrl_status(ctrl, "invalid mixer");
+			return;
+		}
+
+		app->type = type;
+		_mixer_spawn(app, nsinks, nsources);
+		_ctrl_status(ctrl, NULL);
+	}
+	else if(!strcmp(argv[0], "monitor") && ((argc == 3) || (argc == 4)))
+	{
+		const port_type_t type = _port_type_from_string(argv[1]);
+		const int nsinks = atoi(argv[2]);
+		const monitor_mode_t mode = (argc == 4)
+			? _monitor_mode_from_string(argv[3])
+			: MONITOR_MODE_PEAK;
+
+		if( (type == TYPE_NONE) || (nsinks < 1) || (nsinks > PORT_MAX) )
+		{
+			_ctrl_status(ctrl, "invalid monitor");
+			return;
+		}
+
+		app->type = type;
+		_monitor_spawn(app, nsinks, mode);
+		_ctrl_status(ctrl, NULL);
+	}
+	else if(!strcmp(argv[0], "gain") && (argc == 5))
+	{
+		_ctrl_status(ctrl, _ctrl_gain(app, argv));
+	}
+	else if(!strcmp(argv[0], "ramp") && (argc == 3))
+	{
+		_ctrl_status(ctrl, _ctrl_ramp(app, argv));
+	}
+	else if(!strcmp(argv[0], "help") && (argc == 1))
+	{
+		_ctrl_printf(ctrl,
+			"ports\n"
+			"connections\n"
+			"connect source-port sink-port\n"
+			"disconnect source-port sink-port\n"
+			"mixer port-type input-num output-num\n"
+			"monitor port-type input-num [meter-mode]\n"
+			"gain mixer-client source-index sink-index mBFS\n"
+			"ramp mixer-client ramp-time\n");
+		_ctrl_status(ctrl, NULL);
+	}
+	else
+	{
+		_ctrl_status(ctrl, "unknown command");
+	}
+}
+
+// returns false when connection is to be closed
+static bool
+_ctrl_read(app_t *app, ctrl_t *ctrl)
+{
+	const ssize_t n = read(ctrl->fd, &ctrl->line[ctrl->len], CTRL_LINE - 1 - ctrl->len);
+	if(n <= 0)
+		return false;
+
+	ctrl->len += n;
+	ctrl->line[ctrl->len] = '\0';
+
+	char *head = ctrl->line;
+	char *tail;
+	while((tail = strchr(head, '\n')))
+	{
+		*tail = '\0';
+		if( (tail > head) && (tail[-1] == '\r') )
+			tail[-1] = '\0';
+
+		_ctrl_handle(app, ctrl, head);
+		head = tail + 1;
+	}
+
+	ctrl->len -= head - ctrl->line;
+	memmove(ctrl->line, head, ctrl->len);
+
+	if(ctrl->len == CTRL_LINE - 1)
+	{
+		_ctrl_status(ctrl, "command too long");
+		_ctrl_flush(ctrl);
+		return false;
+	}
+
+	return true;
+}
+
+static void
+_ctrl_accept(app_t *app)
+{
+	// never block on a client that does not read its replies
+	const int fd = accept4(app->ctrl, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if(fd == -1)
+		return;
+
+	for(unsigned i = 0; i < CTRL_MAX; i++)
+	{
+		ctrl_t *ctrl = &ctrls[i];
+
+		if(ctrl->fd == -1)
+		{
+			ctrl->fd = fd;
+			ctrl->len = 0;
+			return;
+		}
+	}
+
+	static const char err [] = "error too many connections\n";
+	send(fd, err, sizeof(err) - 1, MSG_NOSIGNAL);
+	close(fd);
+}
+
+// only accessible by the same user, even outside of XDG_RUNTIME_DIR
+static int
+_ctrl_listen(const struct sockaddr_un *addr)
+{
+	const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(fd == -1)
+		return -1;
+
+	const mode_t mask = umask(0077);
+	int ret = bind(fd, (const struct sockaddr *)addr, sizeof(*addr));
+
+	if( (ret == -1) && (errno == EADDRINUSE) )
+	{
+		// take over socket of a crashed daemon, but not of a running one
+		const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+		if( (probe != -1)
+			&& (connect(probe, (const struct sockaddr *)addr, sizeof(*addr)) == -1)
+			&& (unlink(addr->sun_path) == 0) )
+		{
+			ret = bind(fd, (const struct sockaddr *)addr, sizeof(*addr));
+		}
+
+		if(probe != -1)
+			close(probe);
+	}
+
+	umask(mask);
+
+	if( (ret == -1) || (listen(fd, CTRL_MAX) == -1) )
+	{
+		fprintf(stderr, "Cannot listen on `%s'.\n", addr->sun_path);
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void
+_run(app_t *app)
+{
+	while(!atomic_load_explicit(&app->done, memory_order_acquire))
+	{
+		struct pollfd fds [2 + CTRL_MAX];
+		ctrl_t *polled [CTRL_MAX];
+		nfds_t nfds = 0;
+
+		fds[nfds].fd = app->wake;
+		fds[nfds++].events = POLLIN;
+
+		fds[nfds].fd = app->ctrl;
+		fds[nfds++].events = POLLIN;
+
+		for(unsigned i = 0; i < CTRL_MAX; i++)
+		{
+			ctrl_t *ctrl = &ctrls[i];
+
+			if(ctrl->fd == -1)
+				continue;
+
+			// take no further commands until replies to previous ones are out
+			polled[nfds - 2] = ctrl;
+			fds[nfds].fd = ctrl->fd;
+			fds[nfds++].events = ctrl->out_len ? POLLOUT : POLLIN;
+		}
+
+		if(poll(fds, nfds, -1) == -1)
+		{
+			if(errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		if(fds[0].revents & POLLIN)
+		{
+			eventfd_t cnt;
+			eventfd_read(app->wake, &cnt);
+
+			if(_anim(app))
+				break;
+		}
+
+		if(fds[1].revents & POLLIN)
+			_ctrl_accept(app);
+
+		for(nfds_t i = 2; i < nfds; i++)
+		{
+			ctrl_t *ctrl = polled[i - 2];
+
+			if(!(fds[i].revents & (POLLIN | POLLOUT | POLLHUP | POLLERR)))
+				continue;
+
+			const bool alive = (fds[i].revents & POLLOUT)
+				? _ctrl_flush(ctrl)
+				: _ctrl_read(app, ctrl) && _ctrl_flush(ctrl);
+
+			if(!alive)
+				_ctrl_close(ctrl);
+		}
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *ctrl_path = NULL;
+	struct sockaddr_un addr;
+
+	atomic_init(&app.done, false);
+
+	app.scale = 1.f;
+	app.nxt_source = 30;
+	app.nxt_sink = 720/2;
+	app.nxt_default = 30;
+
+	app.server_name = NULL;
+	app.wake = -1;
+	app.ctrl = -1;
+
+	for(unsigned i = 0; i < CTRL_MAX; i++)
+		ctrls[i].fd = -1;
+
+	fprintf(stderr,
+		"%s "PATCHMATRIX_VERSION"\n"
+		"Copyright (c) 2016-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)\n"
+		"Released under Artistic License 2.0 by Open Music Kontrollers\n", argv[0]);
+
+	int c;
+	while((c = getopt(argc, argv, "vhn:s:ez")) != -1)
+	{
+		switch(c)
+		{
+			case 'v':
+				fprintf(stderr,
+					"--------------------------------------------------------------------\n"
+					"This is free software: you can redistribute it and/or modify\n"
+					"it under the terms of the Artistic License 2.0 as published by\n"
+					"The Perl Foundation.\n"
+					"\n"
+					"This source is distributed in the hope that it will be useful,\n"
+					"but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+					"MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the\n"
+					"Artistic License 2.0 for more details.\n"
+					"\n"
+					"You should have received a copy of the Artistic License 2.0\n"
+					"along the source as a COPYING file. If not, obtain it from\n"
+					"http://www.perlfoundation.org/artistic_license_2_0.\n\n");
+				return 0;
+			case 'h':
+				fprintf(stderr,
+					"--------------------------------------------------------------------\n"
+					"USAGE\n"
+					"   %s [OPTIONS]\n"
+					"\n"
+					"OPTIONS\n"
+					"   [-v]                 print version and full license information\n"
+					"   [-h]                 print usage information\n"
+					"   [-n] server-name     connect to named JACK daemon\n"
+					"   [-s] socket-path     listen for control connections at given path\n"
+					"   [-e]                 host mixers and monitors in a shared engine client\n"
+					"   [-z]                 spawn mixers via pre-forked spawn server\n\n"
+					, argv[0]);
+				return 0;
+			case 'n':
+				app.server_name = optarg;
+				break;
+			case 's':
+				ctrl_path = optarg;
+				break;
+			case 'e':
+				app.engine = true;
+				break;
+			case 'z':
+				app.zygote = true;
+				break;
+			case '?':
+				if( (optopt == 'n') || (optopt == 's') )
+					fprintf(stderr, "Option `-%c' requires an argument.\n", optopt);
+				else if(isprint(optopt))
+					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+				else
+					fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+				return -1;
+			default:
+				return -1;
+		}
+	}
+
+	if(ctrl_path)
+	{
+		memset(&addr, 0x0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", ctrl_path);
+	}
+	else
+	{
+		_runtime_addr(&addr, "patchmatrix", app.server_name);
+	}
+
+	signal(SIGINT, _sig_interrupt);
+	signal(SIGTERM, _sig_interrupt);
+	signal(SIGCHLD, _sig_child);
+	signal(SIGPIPE, SIG_IGN); // control connections may go away any time
+
+	if(!(app.from_jack = varchunk_new(0x10000, true)))
+		goto cleanup;
+
+	if((app.wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1)
+		goto cleanup;
+
+	if((app.ctrl = _ctrl_listen(&addr)) == -1)
+		goto cleanup;
+
+	if(_jack_init(&app))
+		goto cleanup;
+
+	if(app.engine)
+		_engine_spawn(&app);
+
+	if(app.zygote)
+		_zygote_spawn(&app);
+
+	_run(&app);
+
+cleanup:
+	for(unsigned i = 0; i < CTRL_MAX; i++)
+	{
+		if(ctrls[i].fd != -1)
+			_ctrl_close(&ctrls[i]);
+	}
+
+	if(app.ctrl != -1)
+	{
+		close(app.ctrl);
+		unlink(addr.sun_path);
+	}
+
+	_jack_deinit(&app);
+
+	if(app.from_jack)
+	{
+		_jack_anim(&app); // drain ringbuffer
+		varchunk_free(app.from_jack);
+	}
+
+	if(app.wake != -1)
+		close(app.wake);
+
+	return 0;
+}
@@ -5,434 +5,536 @@
 
 #include <patchmatrix/patchmatrix_jack.h>
 #include <patchmatrix/patchmatrix_db.h>
-#include <patchmatrix/patchmatrix_nk.h>
+#ifdef PATCHMATRIX_HEADLESS
+#	include <sys/eventfd.h>
+#else
+#	include <patchmatrix/patchmatrix_nk.h>
+#endif
 
-bool
-_jack_anim(app_t *app)
+#define EVENT_BUDGET 256 // maximal number of events to handle per UI frame
+
+static bool
+_jack_event_match(const event_t *ev, const event_t *ref)
 {
-	if(!app->client)
-		return true;
+	switch(ref->type)
+	{
+		case EVENT_PORT_REGISTER:
+		{
+			return (ev->type == EVENT_PORT_REGISTER)
+				&& (ev->port_register.id == ref->port_register.id)
+				&& (ev->port_register.state != ref->port_register.state);
+		}
+		case EVENT_PORT_CONNECT:
+		{
+			return (ev->type == EVENT_PORT_CONNECT)
+				&& (ev->port_connect.id_source == ref->port_connect.id_source)
+				&& (ev->port_connect.id_sink == ref->port_connect.id_sink)
+				&& (ev->port_connect.state != ref->port_connect.state);
+		}
+		default:
+		{
+			return false;
+		}
+	}
+}
 
+static void
+_jack_coalesce(const event_t *batch, bool *skip, unsigned nbatch)
+{
+	// cancel out ports/connections which appear and vanish within a batch
+	for(unsigned i = 0; i < nbatch; i++)
+	{
+		const event_t *ev = &batch[i];
+
+		if(  ((ev->type != EVENT_PORT_REGISTER) || ev->port_register.state)
+			&& ((ev->type != EVENT_PORT_CONNECT) || ev->port_connect.state) )
+		{
+			continue; // only look for unregister/disconnect
+		}
+
+		for(unsigned j = i; j-- > 0; )
+		{
+			if(skip[j])
+				continue;
+
+			if(_jack_event_match(&batch[j], ev))
+			{
+				skip[i] = true;
+				skip[j] = true;
+				break;
+			}
+
+			// any event touching the same port prevents coalescing
+			if(  (ev->type == EVENT_PORT_REGISTER)
+				&& (batch[j].type == EVENT_PORT_CONNECT)
+				&& ( (batch[j].port_connect.id_source == ev->port_register.id)
+					|| (batch[j].port_connect.id_sink == ev->port_register.id) ) )
+			{
+				break;
+			}
+		}
+	}
+}
+
+static bool
+_jack_event_handle(app_t *app, const event_t *ev)
+{
 	bool realize = false;
-	bool quit = false;
 
-	const event_t *ev;
-	size_t len;
-	while((ev = varchunk_read_request(app->from_jack, &len)))
+	switch(ev->type)
 	{
-		switch(ev->type)
+		case EVENT_CLIENT_REGISTER:
 		{
-			case EVENT_CLIENT_REGISTER:
+			if(ev->client_register.state)
 			{
-				if(ev->client_register.state)
-				{
-					// we create clients upon first port registering
-				}
-				else
+				// we create clients upon first port registering
+			}
+			else
+			{
+				client_t *client;
+				while((client = _client_find_by_name(app, ev->client_register.name,
+					JackPortIsInput | JackPortIsOutput)))
 				{
-					client_t *client;
-					while((client = _client_find_by_name(app, ev->client_register.name,
-						JackPortIsInput | JackPortIsOutput)))
-					{
-						_client_remove(app, client);
-						_client_free(app, client);
-					}
+					_client_remove(app, client);
+					_client_free(app, client);
 				}
+			}
 
-				if(ev->client_register.name)
-					free(ev->client_register.name); // strdup
+			if(ev->client_register.name)
+				free(ev->client_register.name); // strdup
 
-				realize = true;
-			} break;
+			realize = true;
+		} break;
 
-			case EVENT_PORT_REGISTER:
+		case EVENT_PORT_REGISTER:
+		{
+			jack_port_t *jport = jack_port_by_id(app->client, ev->port_register.id);
+			if(jport)
 			{
-				jack_port_t *jport = jack_port_by_id(app->client, ev->port_register.id);
-				if(jport)
+				if(ev->port_register.state)
 				{
-					if(ev->port_register.state)
-					{
-						port_t *port = _port_find_by_body(app, jport);
-						if(!port)
-							port = _port_add(app, jport);
-					}
-					else
+					port_t *port = _port_find_by_body(app, jport);
+					if(!port)
+						port = _port_add(app, jport);
+				}
+				else
+				{
+					port_t *port = _port_find_by_body(app, jport);
+					if(port)
 					{
-						port_t *port = _port_find_by_body(app, jport);
-						if(port)
+						client_t *client = port->client;
+
+						_port_remove(app, port);
+						_port_free(port);
+
+						// engine units never unregister as JACK clients
+						if(client->hosted && _hash_empty(&client->ports))
 						{
-							_port_remove(app, port);
-							_port_free(port);
+							_client_remove(app, client);
+							_client_free(app, client);
 						}
 					}
 				}
+			}
 
-				realize = true;
-			} break;
+			realize = true;
+		} break;
 
-			case EVENT_PORT_CONNECT:
+		case EVENT_PORT_CONNECT:
+		{
+			jack_port_t *source_jport = jack_port_by_id(app->client, ev->port_connect.id_source);
+			jack_port_t *sink_jport = jack_port_by_id(app->client, ev->port_connect.id_sink);
+			if(source_jport && sink_jport)
 			{
-				jack_port_t *source_jport = jack_port_by_id(app->client, ev->port_connect.id_source);
-				jack_port_t *sink_jport = jack_port_by_id(app->client, ev->port_connect.id_sink);
-				if(source_jport && sink_jport)
+				port_t *source_port = _port_find_by_body(app, source_jport);
+				port_t *sink_port = _port_find_by_body(app, sink_jport);
+				if(source_port && sink_port)
 				{
-					port_t *source_port = _port_find_by_body(app, source_jport);
-					port_t *sink_port = _port_find_by_body(app, sink_jport);
-					if(source_port && sink_port)
+					client_conn_t *client_conn = _client_conn_find_or_add(app, source_port->client, sink_port->client);
+					if(client_conn)
 					{
-						client_conn_t *client_conn = _client_conn_find_or_add(app, source_port->client, sink_port->client);
-						if(client_conn)
-						{
-							if(ev->port_connect.state)
-								_port_conn_add(client_conn, source_port, sink_port);
-							else
-								_port_conn_remove(app, client_conn, source_port, sink_port);
-						}
+						if(ev->port_connect.state)
+							_port_conn_add(client_conn, source_port, sink_port);
+						else
+							_port_conn_remove(app, client_conn, source_port, sink_port);
 					}
 				}
+			}
 
-				realize = true;
-			} break;
+			realize = true;
+		} break;
 
 #ifdef JACK_HAS_METADATA_API
-			case EVENT_PROPERTY_CHANGE:
+		case EVENT_PROPERTY_CHANGE:
+		{
+			switch(ev->property_change.state)
 			{
-				switch(ev->property_change.state)
+				case PropertyCreated:
 				{
-					case PropertyCreated:
-					{
-						// fall-through
-					}
-					case PropertyChanged:
+					// fall-through
+				}
+				case PropertyChanged:
+				{
+					char *value = NULL;
+					char *type = NULL;
+					if(!jack_uuid_empty(ev->property_change.uuid) && ev->property_change.key)
 					{
-						char *value = NULL;
-						char *type = NULL;
-						if(!jack_uuid_empty(ev->property_change.uuid) && ev->property_change.key)
-						{
-							jack_get_property(ev->property_change.uuid,
-								ev->property_change.key, &value, &type);
+						jack_get_property(ev->property_change.uuid,
+							ev->property_change.key, &value, &type);
 
-							if(value)
+						if(value)
+						{
+							if(!strcmp(ev->property_change.key, JACK_METADATA_PRETTY_NAME))
 							{
-								if(!strcmp(ev->property_change.key, JACK_METADATA_PRETTY_NAME))
-								{
-									port_t *port = NULL;
-									client_t *client = NULL;
-									if((port = _port_find_by_uuid(app, ev->property_change.uuid)))
-									{
-										free(port->pretty_name);
-										port->pretty_name = strdup(value);
-									}
-									else if((client = _client_find_by_uuid(app, ev->property_change.uuid,
-										JackPortIsInput | JackPortIsOutput)))
-									{
-										free(client->pretty_name);
-										client->pretty_name = strdup(value);
-									}
-								}
-								else if(!strcmp(ev->property_change.key, JACKEY_EVENT_TYPES))
-								{
-									port_t *port = _port_find_by_uuid(app, ev->property_change.uuid);
-									if(port)
-									{
-										port->type = TYPE_NONE;
-										if(strcasestr(value, port_labels[TYPE_MIDI]))
-											port->type |= TYPE_MIDI;
-										if(strcasestr(value, port_labels[TYPE_OSC]))
-											port->type |= TYPE_OSC;
-										if(port->type == TYPE_NONE)
-											port->type |= TYPE_MIDI; // fallback, if none defined
-										_client_refresh_type(port->client);
-										HASH_FOREACH(&app->conns, client_conn_itr)
-										{
-											client_conn_t *client_conn = *client_conn_itr;
-
-											_client_conn_refresh_type(client_conn);
-										}
-									}
-								}
-								else if(!strcmp(ev->property_change.key, JACKEY_SIGNAL_TYPE))
+								port_t *port = NULL;
+								client_t *client = NULL;
+								if((port = _port_find_by_uuid(app, ev->property_change.uuid)))
 								{
-									port_t *port = _port_find_by_uuid(app, ev->property_change.uuid);
-									if(port)
-									{
-										port->type = !strcasecmp(value, port_labels[TYPE_CV]) ? TYPE_CV : TYPE_AUDIO;
-										_client_refresh_type(port->client);
-										HASH_FOREACH(&app->conns, client_conn_itr)
-										{
-											client_conn_t *client_conn = *client_conn_itr;
-
-											_client_conn_refresh_type(client_conn);
-										}
-									}
-								}
-								else if(!strcmp(ev->property_change.key, JACKEY_ORDER))
-								{
-									port_t *port = _port_find_by_uuid(app, ev->property_change.uuid);
-									if(port)
-									{
-										port->order = atoi(value);
-										_client_sort(port->client);
-									}
-								}
-								else if(!strcmp(ev->property_change.key, JACK_METADATA_PORT_GROUP))
-								{
-									port_t *port = _port_find_by_uuid(app, ev->property_change.uuid);
-									if(port)
-									{
-										port->designation = _designation_get(value);
-										//FIXME do something?
-									}
-								}
-								else if(!strcmp(ev->property_change.key, PATCHMATRIX__mainPositionX))
-								{
-									client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
-										JackPortIsInput | JackPortIsOutput);
-									if(client)
-										client->pos.x = atof(value);
+									free(port->pretty_name);
+									port->pretty_name = strdup(value);
 								}
-								else if(!strcmp(ev->property_change.key, PATCHMATRIX__mainPositionY))
+								else if((client = _client_find_by_uuid(app, ev->property_change.uuid,
+									JackPortIsInput | JackPortIsOutput)))
 								{
-									client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
-										JackPortIsInput | JackPortIsOutput);
-									if(client)
-										client->pos.y = atof(value);
+									free(client->pretty_name);
+									client->pretty_name = strdup(value);
 								}
-								else if(!strcmp(ev->property_change.key, PATCHMATRIX__sourcePositionX))
+							}
+							else if(!strcmp(ev->property_change.key, JACKEY_EVENT_TYPES))
+							{
+								port_t *port = _port_find_by_uuid(app, ev->property_change.uuid);
+								if(port)
 								{
-									client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
-										JackPortIsOutput);
-									if(client)
-										client->pos.x = atof(value);
+									port_type_t port_type = TYPE_NONE;
+									if(strcasestr(value, port_labels[TYPE_MIDI]))
+										port_type |= TYPE_MIDI;
+									if(strcasestr(value, port_labels[TYPE_OSC]))
+										port_type |= TYPE_OSC;
+									if(port_type == TYPE_NONE)
+										port_type |= TYPE_MIDI; // fallback, if none defined
+									_port_set_type(app, port, port_type);
 								}
-								else if(!strcmp(ev->property_change.key, PATCHMATRIX__sourcePositionY))
+							}
+							else if(!strcmp(ev->property_change.key, JACKEY_SIGNAL_TYPE))
+							{
+								port_t *port = _port_find_by_uuid(app, ev->property_change.uuid);
+								if(port)
 								{
-									client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
-										JackPortIsOutput);
-									if(client)
-										client->pos.y = atof(value);
+									_port_set_type(app, port,
+										!strcasecmp(value, port_labels[TYPE_CV]) ? TYPE_CV : TYPE_AUDIO);
 								}
-								else if(!strcmp(ev->property_change.key, PATCHMATRIX__sinkPositionX))
+							}
+							else if(!strcmp(ev->property_change.key, JACKEY_ORDER))
+							{
+								port_t *port = _port_find_by_uuid(app, ev->property_change.uuid);
+								if(port)
 								{
-									client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
-										JackPortIsInput);
-									if(client)
-										client->pos.x = atof(value);
+									port->order = atoi(value);
+									_client_dirty(app, port->client, DIRTY_SORT);
 								}
-								else if(!strcmp(ev->property_change.key, PATCHMATRIX__sinkPositionY))
+							}
+							else if(!strcmp(ev->property_change.key, JACK_METADATA_PORT_GROUP))
+							{
+								port_t *port = _port_find_by_uuid(app, ev->property_change.uuid);
+								if(port)
 								{
-									client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
-										JackPortIsInput);
-									if(client)
-										client->pos.y = atof(value);
+									port->designation = _designation_get(value);
+									//FIXME do something?
 								}
-
-								free(value);
+							}
+							else if(!strcmp(ev->property_change.key, PATCHMATRIX__mainPositionX))
+							{
+								client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
+									JackPortIsInput | JackPortIsOutput);
+								if(client)
+									client->pos.x = atof(value);
+							}
+							else if(!strcmp(ev->property_change.key, PATCHMATRIX__mainPositionY))
+							{
+								client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
+									JackPortIsInput | JackPortIsOutput);
+								if(client)
+									client->pos.y = atof(value);
+							}
+							else if(!strcmp(ev->property_change.key, PATCHMATRIX__sourcePositionX))
+							{
+								client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
+									JackPortIsOutput);
+								if(client)
+									client->pos.x = atof(value);
+							}
+							else if(!strcmp(ev->property_change.key, PATCHMATRIX__sourcePositionY))
+							{
+								client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
+									JackPortIsOutput);
+								if(client)
+									client->pos.y = atof(value);
+							}
+							else if(!strcmp(ev->property_change.key, PATCHMATRIX__sinkPositionX))
+							{
+								client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
+									JackPortIsInput);
+								if(client)
+									client->pos.x = atof(value);
+							}
+							else if(!strcmp(ev->property_change.key, PATCHMATRIX__sinkPositionY))
+							{
+								client_t *client = _client_find_by_uuid(app, ev->property_change.uuid,
+									JackPortIsInput);
+								if(client)
+									client->pos.y = atof(value);
 							}
 
-							if(type)
-								free(type);
+							free(value);
 						}
 
-						break;
+						if(type)
+							free(type);
 					}
-					case PropertyDeleted:
+
+					break;
+				}
+				case PropertyDeleted:
+				{
+					if(!jack_uuid_empty(ev->property_change.uuid))
 					{
-						if(!jack_uuid_empty(ev->property_change.uuid))
-						{
-							port_t *port = NULL;
-							client_t *client = NULL;
+						port_t *port = NULL;
+						client_t *client = NULL;
 
-							if((port = _port_find_by_uuid(app, ev->property_change.uuid)))
+						if((port = _port_find_by_uuid(app, ev->property_change.uuid)))
+						{
+							bool needs_port_update = false;
+							bool needs_pretty_update = false;
+							bool needs_position_update = false;
+							bool needs_designation_update = false;
+
+							if(  ev->property_change.key
+								&& ( !strcmp(ev->property_change.key, JACKEY_SIGNAL_TYPE)
+									|| !strcmp(ev->property_change.key, JACKEY_EVENT_TYPES) ) )
 							{
-								bool needs_port_update = false;
-								bool needs_pretty_update = false;
-								bool needs_position_update = false;
-								bool needs_designation_update = false;
-
-								if(  ev->property_change.key
-									&& ( !strcmp(ev->property_change.key, JACKEY_SIGNAL_TYPE)
-										|| !strcmp(ev->property_change.key, JACKEY_EVENT_TYPES) ) )
-								{
-									needs_port_update = true;
-								}
-								else if(ev->property_change.key
-									&& !strcmp(ev->property_change.key, JACKEY_ORDER))
-								{
-									needs_position_update = true;
-								}
-								else if(ev->property_change.key
-									&& !strcmp(ev->property_change.key, JACK_METADATA_PORT_GROUP))
-								{
-									needs_designation_update = true;
-								}
-								else if(ev->property_change.key
-									&& !strcmp(ev->property_change.key, JACK_METADATA_PRETTY_NAME))
-								{
-									needs_pretty_update = true;
-								}
-								else // all keys removed
-								{
-									needs_port_update = true;
-									needs_pretty_update = true;
-									needs_position_update = true;
-									needs_designation_update = true;
-								}
-
-								if(needs_port_update)
-								{
-									jack_port_t *jport = jack_port_by_name(app->client, port->name);
-									bool midi = 0;
+								needs_port_update = true;
+							}
+							else if(ev->property_change.key
+								&& !strcmp(ev->property_change.key, JACKEY_ORDER))
+							{
+								needs_position_update = true;
+							}
+							else if(ev->property_change.key
+								&& !strcmp(ev->property_change.key, JACK_METADATA_PORT_GROUP))
+							{
+								needs_designation_update = true;
+							}
+							else if(ev->property_change.key
+								&& !strcmp(ev->property_change.key, JACK_METADATA_PRETTY_NAME))
+							{
+								needs_pretty_update = true;
+							}
+							else // all keys removed
+							{
+								needs_port_update = true;
+								needs_pretty_update = true;
+								needs_position_update = true;
+								needs_designation_update = true;
+							}
 
-									if(jport)
-										midi = !strcmp(jack_port_type(jport), JACK_DEFAULT_MIDI_TYPE) ? true : false;
+							if(needs_port_update)
+							{
+								jack_port_t *jport = jack_port_by_name(app->client, port->name);
+								bool midi = 0;
 
-									port->type = midi ? TYPE_MIDI : TYPE_AUDIO;
+								if(jport)
+									midi = !strcmp(jack_port_type(jport), JACK_DEFAULT_MIDI_TYPE) ? true : false;
 
-									_client_refresh_type(port->client);
-									HASH_FOREACH(&app->conns, client_conn_itr)
-									{
-										client_conn_t *client_conn = *client_conn_itr;
+								_port_set_type(app, port, midi ? TYPE_MIDI : TYPE_AUDIO);
+							}
 
-										_client_conn_refresh_type(client_conn);
-									}
-								}
+							if(needs_pretty_update)
+							{
+								free(port->pretty_name);
+								port->pretty_name = NULL;
+							}
 
-								if(needs_pretty_update)
-								{
-									free(port->pretty_name);
-									port->pretty_name = NULL;
-								}
+							if(needs_position_update)
+							{
+								port->order = 0;
 
-								if(needs_position_update)
-								{
-									port->order = 0;
+								_client_dirty(app, port->client, DIRTY_SORT);
+							}
 
-									client_t *client2 = port->client;
-									_client_sort(client2);
-								}
+							if(needs_designation_update)
+							{
+								port->designation = DESIGNATION_NONE;
+								//FIXME do something?
+							}
+						}
+						else if((client = _client_find_by_uuid(app, ev->property_change.uuid,
+							JackPortIsInput | JackPortIsOutput)))
+						{
+							bool needs_pretty_update = false;
 
-								if(needs_designation_update)
-								{
-									port->designation = DESIGNATION_NONE;
-									//FIXME do something?
-								}
+							if(ev->property_change.key
+								&& !strcmp(ev->property_change.key, JACK_METADATA_PRETTY_NAME))
+							{
+								needs_pretty_update = true;
 							}
-							else if((client = _client_find_by_uuid(app, ev->property_change.uuid,
-								JackPortIsInput | JackPortIsOutput)))
+							else // all keys removed
 							{
-								bool needs_pretty_update = false;
-
-								if(ev->property_change.key
-									&& !strcmp(ev->property_change.key, JACK_METADATA_PRETTY_NAME))
-								{
-									needs_pretty_update = true;
-								}
-								else // all keys removed
-								{
-									needs_pretty_update = true;
-								}
+								needs_pretty_update = true;
+							}
 
-								if(needs_pretty_update)
-								{
-									free(client->pretty_name);
-									client->pretty_name = NULL;
-								}
+							if(needs_pretty_update)
+							{
+								free(client->pretty_name);
+								client->pretty_name = NULL;
 							}
 						}
-						else
-						{
-							fprintf(stderr, "all properties in current JACK session deleted\n");
-							//TODO
-						}
-
-						break;
 					}
+					else
+					{
+						fprintf(stderr, "all properties in current JACK session deleted\n");
+						//TODO
+					}
+
+					break;
 				}
+			}
 
-				if(ev->property_change.key)
-					free(ev->property_change.key); // strdup
+			if(ev->property_change.key)
+				free(ev->property_change.key); // strdup
 
-				realize = true;
-			} break;
+			realize = true;
+		} break;
 #endif
 
-			case EVENT_ON_INFO_SHUTDOWN:
-			{
-				app->client = NULL; // JACK has shut down, hasn't it?
+		case EVENT_ON_INFO_SHUTDOWN:
+		{
+			app->client = NULL; // JACK has shut down, hasn't it?
 
-			} break;
+		} break;
 
-			case EVENT_GRAPH_ORDER:
-			{
-				//FIXME
-			} break;
+		case EVENT_GRAPH_ORDER:
+		{
+			//FIXME
+		} break;
 
-			case EVENT_FREEWHEEL:
-			{
-				app->freewheel = ev->freewheel.starting;
+		case EVENT_FREEWHEEL:
+		{
+			app->freewheel = ev->freewheel.starting;
 
-				realize = true;
-			} break;
+			realize = true;
+		} break;
 
-			case EVENT_BUFFER_SIZE:
-			{
-				app->buffer_size = ev->buffer_size.nframes;
+		case EVENT_BUFFER_SIZE:
+		{
+			app->buffer_size = ev->buffer_size.nframes;
 
-				realize = true;
-			} break;
+			realize = true;
+		} break;
 
-			case EVENT_SAMPLE_RATE:
-			{
-				app->sample_rate = ev->sample_rate.nframes;
+		case EVENT_SAMPLE_RATE:
+		{
+			app->sample_rate = ev->sample_rate.nframes;
 
-				realize = true;
-			} break;
+			realize = true;
+		} break;
 
-			case EVENT_XRUN:
-			{
-				app->xruns += 1;
+		case EVENT_XRUN:
+		{
+			app->xruns += 1;
 
-				realize = true;
-			} break;
+			realize = true;
+		} break;
 
 #ifdef JACK_HAS_PORT_RENAME_CALLBACK
-			case EVENT_PORT_RENAME:
+		case EVENT_PORT_RENAME:
+		{
+			port_t *port = _port_find_by_name(app, ev->port_rename.old_name);
+			if(port && ev->port_rename.new_name)
 			{
-				port_t *port = _port_find_by_name(app, ev->port_rename.old_name);
-				if(port)
-				{
-					free(port->name);
-					free(port->short_name);
+				_port_rename(app, port, ev->port_rename.new_name);
+				_client_dirty(app, port->client, DIRTY_SORT);
+			}
 
-					const char *name = ev->port_rename.new_name;
-					char *sep = strchr(name, ':');
-					const char *short_name = sep + 1;
+			if(ev->port_rename.old_name)
+				free(ev->port_rename.old_name);
+			if(ev->port_rename.new_name)
+				free(ev->port_rename.new_name);
 
-					port->name = strdup(name);
-					port->short_name = strdup(short_name);
-					_client_sort(port->client);
-				}
+			realize = true;
+		} break;
+#endif
+	};
 
-				if(ev->port_rename.old_name)
-					free(ev->port_rename.old_name);
-				if(ev->port_rename.new_name)
-					free(ev->port_rename.new_name);
+	return realize;
+}
 
-				realize = true;
-			} break;
-#endif
-		};
+bool
+_jack_anim(app_t *app)
+{
+	if(!app->client)
+		return true;
+
+	event_t batch [EVENT_BUDGET];
+	bool skip [EVENT_BUDGET];
+	unsigned nbatch = 0;
+	bool realize = false;
+	bool quit = false;
+
+	// grab pending events up to the per-frame budget
+	const event_t *ev;
+	size_t len;
+	while( (nbatch < EVENT_BUDGET)
+		&& (ev = varchunk_read_request(app->from_jack, &len)) )
+	{
+		batch[nbatch] = *ev;
+		skip[nbatch] = false;
+		nbatch++;
 
 		varchunk_read_advance(app->from_jack);
 	}
 
+	_jack_coalesce(batch, skip, nbatch);
+
+	for(unsigned i = 0; i < nbatch; i++)
+	{
+		if(skip[i])
+		{
+			realize = true;
+			continue;
+		}
+
+		if(_jack_event_handle(app, &batch[i]))
+			realize = true;
+	}
+
+	// sort touched clients once per batch
+	_client_flush(app);
+
+	if(nbatch == EVENT_BUDGET) // there may be more pending, continue next frame
+		realize = true;
+
 	if(realize)
+	{
+		app->spatial.dirty = true; // positions or sizes may have changed
+#ifndef PATCHMATRIX_HEADLESS
 		nk_pugl_post_redisplay(&app->win);
+#endif
+	}
 
 	return quit;
 }
 
+// wake up main loop from JACK notification thread
+static inline void
+_jack_signal(app_t *app)
+{
+#ifdef PATCHMATRIX_HEADLESS
+	eventfd_write(app->wake, 1);
+#else
+	_ui_signal(app);
+#endif
+}
+
 static void
 _jack_on_info_shutdown_cb(jack_status_t code, const char *reason, void *arg)
 {
@@ -446,7 +548,7 @@ _jack_on_info_shutdown_cb(jack_status_t code, const char *reason, void *arg)
 		ev->on_info_shutdown.reason = strdup(reason);
 
 		varchunk_write_advance(app->from_jack, sizeof(event_t));
-		_ui_signal(app);
+		_jack_signal(app);
 	}
 }
 
@@ -462,7 +564,7 @@ _jack_freewheel_cb(int starting, void *arg)
 		ev->freewheel.starting = starting;
 
 		varchunk_write_advance(app->from_jack, sizeof(event_t));
-		_ui_signal(app);
+		_jack_signal(app);
 	}
 }
 
@@ -478,7 +580,7 @@ _jack_buffer_size_cb(jack_nframes_t nframes, void *arg)
 		ev->buffer_size.nframes = nframes;
 
 		varchunk_write_advance(app->from_jack, sizeof(event_t));
-		_ui_signal(app);
+		_jack_signal(app);
 	}
 
 	return 0;
@@ -496,7 +598,7 @@ _jack_sample_rate_cb(jack_nframes_t nframes, void *arg)
 		ev->sample_rate.nframes = nframes;
 
 		varchunk_write_advance(app->from_jack, sizeof(event_t));
-		_ui_signal(app);
+		_jack_signal(app);
 	}
 
 	return 0;
@@ -515,7 +617,7 @@ _jack_client_registration_cb(const char *name, int state, void *arg)
 		ev->client_register.state = state;
 
 		varchunk_write_advance(app->from_jack, sizeof(event_t));
-		_ui_signal(app);
+		_jack_signal(app);
 	}
 }
 
@@ -532,7 +634,7 @@ _jack_port_registration_cb(jack_port_id_t id, int state, void *arg)
 		ev->port_register.state = state;
 
 		varchunk_write_advance(app->from_jack, sizeof(event_t));
-		_ui_signal(app);
+		_jack_signal(app);
 	}
 }
 
@@ -550,7 +652,7 @@ _jack_port_rename_cb(jack_port_id_t id, const char *old_name, const char *new_na
 		ev->port_rename.new_name = strdup(new_name);
 
 		varchunk_write_advance(app->from_jack, sizeof(event_t));
-		_ui_signal(app);
+		_jack_signal(app);
 	}
 }
 #endif
@@ -569,7 +671,7 @@ _jack_port_connect_cb(jack_port_id_t id_source, jack_port_id_t id_sink, int stat
 		ev->port_connect.state = state;
 
 		varchunk_write_advance(app->from_jack, sizeof(event_t));
-		_ui_signal(app);
+		_jack_signal(app);
 	}
 }
 
@@ -584,7 +686,7 @@ _jack_xrun_cb(void *arg)
 		ev->type = EVENT_XRUN;
 
 		varchunk_write_advance(app->from_jack, sizeof(event_t));
-		_ui_signal(app);
+		_jack_signal(app);
 	}
 
 	return 0;
@@ -601,7 +703,7 @@ _jack_graph_order_cb(void *arg)
 		ev->type = EVENT_GRAPH_ORDER;
 
 		varchunk_write_advance(app->from_jack, sizeof(event_t));
-		_ui_signal(app);
+		_jack_signal(app);
 	}
 
 	return 0;
@@ -622,7 +724,7 @@ _jack_property_change_cb(jack_uuid_t uuid, const char *key, jack_property_change
 		ev->property_change.state = state;
 
 		varchunk_write_advance(app->from_jack, sizeof(event_t));
-		_ui_signal(app);
+		_jack_signal(app);
 	}
 }
 #endif
@@ -634,6 +736,10 @@ _jack_populate(app_t *app)
 	if(!port_names)
 		return;
 
+#ifdef JACK_HAS_METADATA_API
+	_snapshot_begin(app);
+#endif
+
 	for(const char **itr = port_names; *itr; itr++)
 	{
 		const char *port_name = *itr;
@@ -644,6 +750,10 @@ _jack_populate(app_t *app)
 	}
 	jack_free(port_names);
 
+#ifdef JACK_HAS_METADATA_API
+	_snapshot_end(app);
+#endif
+
 	HASH_FOREACH(&app->clients, client_itr)
 	{
 		client_t *client = *client_itr;
@@ -652,6 +762,9 @@ _jack_populate(app_t *app)
 		{
 			port_t *source_port = *source_port_itr;
 
+			if(!jack_port_connected(source_port->body))
+				continue; // spare the round-trip
+
 			const char **connections = jack_port_get_all_connections(app->client, source_port->body);
 			if(!connections)
 				continue;
@@ -671,6 +784,8 @@ _jack_populate(app_t *app)
 			jack_free(connections);
 		}
 	}
+
+	_client_flush(app);
 }
 
 static void
@@ -689,6 +804,31 @@ _jack_depopulate(app_t *app)
 
 		_client_free(app, client);
 	}
+
+	_hash_free(&app->dirty_clients);
+
+	_index_free(&app->client_names);
+#ifdef JACK_HAS_METADATA_API
+	_index_free(&app->client_uuids);
+#endif
+	_index_free(&app->port_names);
+	_index_free(&app->port_bodies);
+#ifdef JACK_HAS_METADATA_API
+	_index_free(&app->port_uuids);
+#endif
+	_index_free(&app->client_conns);
+
+	spatial_t *spatial = &app->spatial;
+	for(unsigned b = 0; b < SPATIAL_BUCKETS; b++)
+		_hash_free(&spatial->buckets[b]);
+	_hash_free(&spatial->pinned);
+	_hash_free(&spatial->result);
+	_hash_free(&spatial->visible);
+	free(spatial->nodes);
+	spatial->nodes = NULL;
+	spatial->size = 0;
+	spatial->capacity = 0;
+	spatial->dirty = true;
 }
 
 int
@@ -6,20 +6,134 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <time.h>
 
 #include <patchmatrix/patchmatrix.h>
+#include <patchmatrix/patchmatrix_dsp.h>
+#include <patchmatrix/patchmatrix_gain.h>
+#include <patchmatrix/patchmatrix_osc.h>
 
+#include <osc.lv2/osc.h>
+
+#ifdef PATCHMATRIX_UNIT
+#	include <patchmatrix/patchmatrix_engine.h>
+#endif
+
+#define MIXER_SCHED_MAX 1024 // pending timed gain changes
+#define JAN_1970 2208988800ULL // seconds from NTP to UNIX epoch
+#define MIXER_THREAD_MAX 16 // process callback thread plus workers
+#define MIXER_THREAD_CELLS 64 // minimum live cells per thread worth waking workers
+
+typedef struct _mixer_cell_t mixer_cell_t;
+typedef struct _mixer_filter_t mixer_filter_t;
+typedef struct _mixer_cc_t mixer_cc_t;
+typedef struct _mixer_sched_item_t mixer_sched_item_t;
+typedef struct _mixer_sched_t mixer_sched_t;
+typedef struct _mixer_live_t mixer_live_t;
+typedef struct _mixer_worker_t mixer_worker_t;
+typedef struct _mixer_pool_t mixer_pool_t;
 typedef struct _mixer_app_t mixer_app_t;
 
+struct _mixer_cell_t {
+	int32_t mBFS; // target as read from shm, thousandths for CV
+	float gain; // linear, currently applied
+	float target; // linear, zero when not to be mixed
+	float step; // gain increment per frame while ramping
+	uint32_t ramp; // frames left to ramp
+	const osc_pattern_t *filter; // OSC address filter, NULL passes all
+};
+
+struct _mixer_cc_t {
+	bool mapped;
+	uint16_t source;
+	uint16_t sink;
+	int16_t val; // 14-bit, as assembled from MSB and LSB
+};
+
+struct _mixer_filter_t {
+	unsigned source;
+	unsigned sink;
+	osc_pattern_t pattern;
+};
+
+// compressed sparse rows of live cells, by source for audio, by sink for MIDI
+struct _mixer_live_t {
+	unsigned *offs; // nrows + 1 offsets into idxs
+	unsigned *idxs; // column indexes of live cells, row after row
+	bool dirty; // set of live cells changed, rebuild before next use
+};
+
+struct _mixer_sched_item_t {
+	jack_nframes_t frame; // absolute JACK frame time, wraps around
+	uint32_t seq; // keeps changes due at same frame in order of arrival
+	uint16_t source;
+	uint16_t sink;
+	int32_t mBFS;
+};
+
+// fixed-size min-heap of OSC gain changes with future bundle timetags
+struct _mixer_sched_t {
+	LV2_OSC_Schedule osc; // conversion relative to start of current cycle
+	jack_nframes_t frames; // JACK frame time at start of current cycle
+	uint64_t timetag; // OSC timetag at start of current cycle
+	double rate; // frames per second as measured by DLL
+	uint32_t seq;
+	unsigned n;
+	mixer_sched_item_t items [MIXER_SCHED_MAX];
+};
+
+struct _mixer_worker_t {
+	mixer_app_t *mixer;
+	unsigned part; // index into pool bounds
+	jack_native_thread_t thread;
+	sem_t go;
+	bool dirty; // some cell faded out, handed back to process callback
+};
+
+// RT worker threads summing disjoint ranges of audio source rows
+struct _mixer_pool_t {
+	unsigned nthreads; // including process callback thread
+	unsigned nworkers; // actually running
+	mixer_worker_t *workers;
+	unsigned *bounds; // nthreads + 1 source row boundaries, balanced on live cells
+	sem_t done;
+	jack_nframes_t from; // segment to render, published before waking workers
+	jack_nframes_t to;
+	atomic_bool quit;
+};
+
 struct _mixer_app_t {
 	jack_client_t *client;
+	char *name; // of shm, prefix of ports when hosted by engine
+	unsigned nsinks;
+	unsigned nsources;
 	jack_port_t *jautom;
-	jack_port_t *jsinks [PORT_MAX];
-	jack_port_t *jsources[PORT_MAX];
+	jack_port_t **jsinks;
+	jack_port_t **jsources;
 	port_type_t type;
 
 	int16_t nrpn [0x10];
 	int16_t data [0x10];
+	mixer_cc_t cc [0x10][0x20]; // 14-bit controller mapping per channel
+
+	mixer_cell_t *cells; // laid out like shm gains, private to process callback
+	mixer_filter_t *filters; // compiled before activation, referenced by cells
+	unsigned nfilters;
+	mixer_live_t live;
+	mixer_pool_t pool;
+	uint32_t ramp_frames;
+	uint32_t sample_rate;
+	dsp_t dsp;
+	mixer_sched_t sched;
+
+	struct {
+		void **sinks; // plus automation port
+		void **sources;
+		unsigned *count;
+		unsigned *pos;
+		jack_midi_event_t *evs; // next pending event per MIDI input
+		unsigned *heap; // MIDI inputs with pending events, min-heap on event time
+	} buf; // per-cycle port buffers, preallocated to keep process callback RT-safe
 
 	mixer_shm_t *shm;	
 };
@@ -42,57 +156,301 @@ _jack_on_info_shutdown_cb(jack_status_t code, const char *reason, void *arg)
 	_close(shm);
 }
 
-static inline void
-_midi_handle_data(mixer_app_t *mixer, uint8_t chn)
+static inline mixer_cell_t *
+_mixer_cell(mixer_app_t *mixer, unsigned j, unsigned i)
+{
+	return &mixer->cells[j*mixer->shm->stride + i];
+}
+
+// MIDI and OSC mixers route events instead of summing signals
+static inline bool
+_mixer_events(mixer_app_t *mixer)
+{
+#ifdef JACK_HAS_METADATA_API
+	if(mixer->type == TYPE_OSC)
+		return true;
+#endif
+
+	return mixer->type == TYPE_MIDI;
+}
+
+static inline bool
+_mixer_cell_offset(mixer_app_t *mixer, unsigned i)
+{
+	return i == mixer->shm->nsinks; // CV offset column
+}
+
+static inline bool
+_mixer_cell_active(const mixer_cell_t *cell)
+{
+	return (cell->gain != 0.f) || (cell->target != 0.f);
+}
+
+static inline bool
+_mixer_cell_live(mixer_app_t *mixer, const mixer_cell_t *cell)
+{
+	if(_mixer_events(mixer)) // events are not ramped
+		return cell->target != 0.f;
+
+	return _mixer_cell_active(cell);
+}
+
+// split rows into contiguous ranges of about equal weight, a row counting
+// its live cells plus one for clearing or writing its output
+static void
+_mixer_pool_partition(mixer_app_t *mixer)
+{
+	mixer_shm_t *shm = mixer->shm;
+	mixer_pool_t *pool = &mixer->pool;
+	const unsigned *offs = mixer->live.offs;
+	const unsigned total = offs[shm->nsources] + shm->nsources;
+	unsigned j = 0;
+
+	pool->bounds[0] = 0;
+
+	for(unsigned t = 1; t < pool->nthreads; t++)
+	{
+		const unsigned weight = (uint64_t)total * t / pool->nthreads;
+
+		while( (j < shm->nsources) && (offs[j] + j < weight) )
+			j++;
+
+		pool->bounds[t] = j;
+	}
+
+	pool->bounds[pool->nthreads] = shm->nsources;
+}
+
+static void
+_mixer_live_rebuild(mixer_app_t *mixer)
 {
-	const uint8_t nrpn_msb = mixer->nrpn[chn] >> 7;
-	const uint8_t nrpn_lsb = mixer->nrpn[chn] & 0x7f;
 	mixer_shm_t *shm = mixer->shm;
+	mixer_live_t *live = &mixer->live;
+	unsigned n = 0;
+
+	if(_mixer_events(mixer)) // events are routed sink by sink
+	{
+		for(unsigned i = 0; i < shm->nsinks; i++)
+		{
+			live->offs[i] = n;
+
+			for(unsigned j = 0; j < shm->nsources; j++)
+			{
+				if(_mixer_cell_live(mixer, _mixer_cell(mixer, j, i)))
+					live->idxs[n++] = j;
+			}
+		}
 
-	if( (nrpn_msb < shm->nsources) && (nrpn_lsb < shm->nsinks) )
+		live->offs[shm->nsinks] = n;
+	}
+	else // audio is summed source by source
 	{
-		const int32_t mBFS = (float)(mixer->data[chn] - 0x1fff)/0x2000 * 3600.f;
+		for(unsigned j = 0; j < shm->nsources; j++)
+		{
+			live->offs[j] = n;
+
+			for(unsigned i = 0; i < shm->nsinks; i++)
+			{
+				if(_mixer_cell_live(mixer, _mixer_cell(mixer, j, i)))
+					live->idxs[n++] = i;
+			}
+		}
 
-		atomic_store_explicit(&shm->jgains[nrpn_msb][nrpn_lsb], mBFS, memory_order_relaxed);
+		live->offs[shm->nsources] = n;
+
+		_mixer_pool_partition(mixer);
 	}
+
+	live->dirty = false;
 }
 
 static inline void
-_midi_handle(mixer_app_t *mixer, jack_midi_event_t *ev)
+_mixer_gain_update(mixer_app_t *mixer, unsigned j, unsigned i, int32_t mBFS,
+	bool ramp)
 {
-	const uint8_t cmd = ev->buffer[0] & 0xf0;
+	mixer_cell_t *cell = _mixer_cell(mixer, j, i);
 
-	if(cmd != 0xb0)
+	if(ramp && (cell->mBFS == mBFS)) // unchanged, keep ramping if so
+		return;
+
+	cell->mBFS = mBFS;
+
+	if(_mixer_cell_offset(mixer, i)) // DC offset, applied without ramp
 	{
+		cell->ramp = 0;
+		cell->gain = cell->target = _gain_from_cv(mBFS);
 		return;
 	}
 
-	const uint8_t chn = ev->buffer[0] & 0x0f;
-	const uint8_t ctr = ev->buffer[1];
-	const uint8_t val = ev->buffer[2];
+	const bool was_live = _mixer_cell_live(mixer, cell);
+
+#ifdef JACK_HAS_METADATA_API
+	if(mixer->type == TYPE_CV) // linear, zero if not to be mixed
+		cell->target = (mBFS > GAIN_MIN) ? _gain_from_cv(mBFS) : 0.f;
+	else
+#endif
+		cell->target = _gain_from_mBFS(mBFS); // zero if not to be mixed
+
+	if(ramp && mixer->ramp_frames) // fade from current gain
+	{
+		cell->ramp = mixer->ramp_frames;
+		cell->step = (cell->target - cell->gain) / cell->ramp;
+	}
+	else // jump
+	{
+		cell->ramp = 0;
+		cell->gain = cell->target;
+	}
+
+	if(_mixer_cell_live(mixer, cell) != was_live)
+		mixer->live.dirty = true;
+}
+
+static void
+_mixer_gains_refresh(mixer_app_t *mixer, bool ramp)
+{
+	mixer_shm_t *shm = mixer->shm;
+	const unsigned ncols = _mixer_shm_ncols(shm);
+
+	for(unsigned j = 0; j < shm->nsources; j++)
+	{
+		for(unsigned i = 0; i < ncols; i++)
+		{
+			const int32_t mBFS = atomic_load_explicit(_mixer_shm_gain(shm, j, i), memory_order_relaxed);
+
+			_mixer_gain_update(mixer, j, i, mBFS, ramp);
+		}
+	}
+}
+
+static inline void
+_mixer_ramp_set(mixer_app_t *mixer, uint32_t ms)
+{
+	if(ms > 1000)
+		ms = 1000;
+
+	mixer->ramp_frames = (uint64_t)ms * mixer->sample_rate / 1000;
+}
+
+static inline void
+_mixer_cmd_handle(mixer_app_t *mixer, const mixer_cmd_t *cmd)
+{
+	mixer_shm_t *shm = mixer->shm;
+
+	switch(cmd->type)
+	{
+		case MIXER_CMD_GAIN:
+		{
+			if( (cmd->gain.source < shm->nsources) && (cmd->gain.sink < _mixer_shm_ncols(shm)) )
+				_mixer_gain_update(mixer, cmd->gain.source, cmd->gain.sink, cmd->gain.mBFS, true);
+		} break;
+		case MIXER_CMD_RAMP:
+		{
+			_mixer_ramp_set(mixer, cmd->ramp.ms);
+		} break;
+	}
+}
+
+static inline void
+_mixer_gains_sync(mixer_app_t *mixer)
+{
+	mixer_shm_t *shm = mixer->shm;
+	varchunk_t *ring = _mixer_shm_ring(shm);
+
+	// apply only what UI has changed since last time
+	const mixer_cmd_t *cmd;
+	size_t len;
+	while((cmd = varchunk_read_request(ring, &len)))
+	{
+		if(len >= sizeof(mixer_cmd_t))
+			_mixer_cmd_handle(mixer, cmd);
+
+		varchunk_read_advance(ring);
+	}
+
+	// UI could not queue a command, rederive all gains from mirror
+	if(atomic_exchange_explicit(&shm->resync, false, memory_order_acquire))
+		_mixer_gains_refresh(mixer, true);
+}
+
+static inline void
+_mixer_gain_set(mixer_app_t *mixer, unsigned j, unsigned i, int32_t mBFS)
+{
+	mixer_shm_t *shm = mixer->shm;
+
+	// keep mirror in sync for UI
+	atomic_store_explicit(_mixer_shm_gain(shm, j, i), mBFS, memory_order_relaxed);
+	atomic_fetch_add_explicit(&shm->seq, 1, memory_order_release);
+
+	_mixer_gain_update(mixer, j, i, mBFS, true);
+}
+
+// 14-bit automation value to gain in mBFS
+static inline int32_t
+_midi_mBFS(int16_t val)
+{
+	return (float)(val - 0x1fff)/0x2000 * GAIN_MAX;
+}
+
+static inline void
+_midi_gain_set(mixer_app_t *mixer, unsigned j, unsigned i, int16_t val)
+{
+	mixer_shm_t *shm = mixer->shm;
+
+	if( (j < shm->nsources) && (i < _mixer_shm_ncols(shm)) )
+		_mixer_gain_set(mixer, j, i, _midi_mBFS(val));
+}
+
+static inline void
+_midi_handle_data(mixer_app_t *mixer, uint8_t chn)
+{
+	const uint8_t nrpn_msb = mixer->nrpn[chn] >> 7;
+	const uint8_t nrpn_lsb = mixer->nrpn[chn] & 0x7f;
+
+	_midi_gain_set(mixer, nrpn_msb, nrpn_lsb, mixer->data[chn]);
+}
+
+static inline void
+_midi_handle_cc(mixer_app_t *mixer, uint8_t chn, uint8_t ctr, uint8_t val)
+{
+	if(ctr < 0x40) // 14-bit controller pair, MSB at ctr, LSB at ctr + 0x20
+	{
+		mixer_cc_t *cc = &mixer->cc[chn][ctr & 0x1f];
+
+		if(cc->mapped)
+		{
+			if(ctr & 0x20)
+				cc->val = (cc->val & ~0x7f) | val;
+			else // MSB resets LSB
+				cc->val = val << 7;
+
+			_midi_gain_set(mixer, cc->source, cc->sink, cc->val);
+			return;
+		}
+	}
 
 	switch(ctr)
 	{
 		case 0x62: // NRPN_LSB
 		{
-			mixer->nrpn[chn] &= ~0x3f80;
+			mixer->nrpn[chn] &= ~0x7f;
 			mixer->nrpn[chn] |= val;
 		} break;
 		case 0x63: // NRPN_MSB
 		{
-			mixer->nrpn[chn] &= ~0x7f;
+			mixer->nrpn[chn] &= ~0x3f80;
 			mixer->nrpn[chn] |= (val << 7);
 		} break;
 		case 0x26: // DATA_LSB
 		{
-			mixer->data[chn] &= ~0x3f80;
+			mixer->data[chn] &= ~0x7f;
 			mixer->data[chn] |= val;
 
 			_midi_handle_data(mixer, chn);
 		} break;
 		case 0x06: // DATA_MSB
 		{
-			mixer->data[chn] &= ~0x7f;
+			mixer->data[chn] &= ~0x3f80;
 			mixer->data[chn] |= (val << 7);
 
 			_midi_handle_data(mixer, chn);
@@ -100,281 +458,1475 @@ _midi_handle(mixer_app_t *mixer, jack_midi_event_t *ev)
 	}
 }
 
-#include <osc.lv2/reader.h>
-
-static inline void
-_osc_message_handle(mixer_app_t *mixer, LV2_OSC_Reader *reader)
+// F0 7D 50 01 followed by (row, column, gain) triples of 14-bit MSB/LSB pairs, F7,
+// returns number of bytes consumed, up to F7 or up to a status byte aborting it
+static inline size_t
+_midi_handle_sysex(mixer_app_t *mixer, const uint8_t *buf, size_t size)
 {
-	const char *path = NULL;
-	const char *type= NULL;
+	static const uint8_t hdr [] = { 0x7d, 0x50, 0x01 };
+	bool ours = true;
+	size_t ndata = 0;
+	size_t eox;
 
-	lv2_osc_reader_get_string(reader, &path);
-	if(!path || strcmp(path, "/patchmatrix/mixer"))
-		return;
+	// validate whole block before applying any of it
+	for(eox = 1; (eox < size) && (buf[eox] != 0xf7); eox++)
+	{
+		if(buf[eox] >= 0xf8) // real-time, may be interleaved anywhere
+			continue;
 
-	lv2_osc_reader_get_string(reader, &type);
-	if(!type || strcmp(type, ",iif"))
-		return;
+		if(buf[eox] & 0x80) // any other status aborts block
+			return eox;
 
-	int32_t nsink = 0;
-	int32_t nsource = 0;
-	float mBFS = 0.f;
+		if( (ndata < sizeof(hdr)) && (buf[eox] != hdr[ndata]) )
+			ours = false;
 
-	lv2_osc_reader_get_int32(reader, &nsink);
-	lv2_osc_reader_get_int32(reader, &nsource);
-	lv2_osc_reader_get_float(reader, &mBFS);
+		ndata++;
+	}
 
-	mixer_shm_t *shm = mixer->shm;
-	atomic_store_explicit(&shm->jgains[nsource][nsink], mBFS, memory_order_relaxed);
+	if(eox == size) // unterminated
+		return size;
+
+	if( !ours || (ndata < sizeof(hdr)) || ((ndata - sizeof(hdr)) % 6) )
+		return eox + 1;
+
+	uint8_t data [6];
+	size_t skip = sizeof(hdr);
+	unsigned n = 0;
+
+	for(size_t k = 1; k < eox; k++)
+	{
+		if(buf[k] >= 0xf8)
+			continue;
+
+		if(skip)
+		{
+			skip--;
+			continue;
+		}
+
+		data[n++] = buf[k];
+
+		if(n == 6)
+		{
+			const unsigned j = (data[0] << 7) | data[1];
+			const unsigned i = (data[2] << 7) | data[3];
+			const int16_t val = (data[4] << 7) | data[5];
+
+			_midi_gain_set(mixer, j, i, val);
+			n = 0;
+		}
+	}
+
+	return eox + 1;
 }
 
+static inline unsigned
+_midi_data_len(uint8_t status)
+{
+	switch(status & 0xf0)
+	{
+		case 0xc0: // program change
+		case 0xd0: // channel pressure
+			return 1;
+		case 0xf0: // system common
+			return ( (status == 0xf1) || (status == 0xf3) ) ? 1
+				: (status == 0xf2) ? 2
+				: 0;
+	}
+
+	return 2;
+}
+
+// parse whole event, which may pack several messages with running status
 static inline void
-_osc_packet_handle(mixer_app_t *mixer, const uint8_t *body, size_t size)
+_midi_handle(mixer_app_t *mixer, const uint8_t *buf, size_t size)
 {
-	LV2_OSC_Reader reader;
-	lv2_osc_reader_initialize(&reader, body, size);
+	uint8_t status = 0;
 
-	if(lv2_osc_reader_is_bundle(&reader))
+	for(size_t k = 0; k < size; )
 	{
-		OSC_READER_BUNDLE_FOREACH(&reader, itm, size)
+		const uint8_t byte = buf[k];
+
+		if(byte == 0xf0) // SysEx runs up to F7, cancels running status
+		{
+			k += _midi_handle_sysex(mixer, &buf[k], size - k);
+
+			status = 0;
+			continue;
+		}
+
+		if(byte >= 0xf8) // real-time, leaves running status untouched
+		{
+			k += 1;
+			continue;
+		}
+
+		if(byte & 0x80) // new status
+		{
+			status = (byte < 0xf0) ? byte : 0; // system common cancels running status
+			k += 1 + ((byte < 0xf0) ? 0 : _midi_data_len(byte));
+			continue;
+		}
+
+		if(!status) // stray data byte
 		{
-			_osc_packet_handle(mixer, itm->body, itm->size);
+			k += 1;
+			continue;
 		}
+
+		const unsigned len = _midi_data_len(status);
+		if(k + len > size)
+			return;
+
+		if((status & 0xf0) == 0xb0)
+			_midi_handle_cc(mixer, status & 0x0f, buf[k], buf[k + 1]);
+
+		k += len;
 	}
-	else if(lv2_osc_reader_is_message(&reader))
+}
+
+static double
+_mixer_osc2frames(LV2_OSC_Schedule_Handle handle, uint64_t timetag)
+{
+	mixer_app_t *mixer = handle;
+	mixer_sched_t *sched = &mixer->sched;
+
+	if(timetag == LV2_OSC_IMMEDIATE)
+		return 0.0;
+
+	const int64_t dt = timetag - sched->timetag; // 32.32 fixed point seconds
+
+	return dt * sched->rate / 0x1p32;
+}
+
+static uint64_t
+_mixer_frames2osc(LV2_OSC_Schedule_Handle handle, double frames)
+{
+	mixer_app_t *mixer = handle;
+	mixer_sched_t *sched = &mixer->sched;
+
+	return sched->timetag + (int64_t)(frames / sched->rate * 0x1p32);
+}
+
+static void
+_mixer_sched_init(mixer_app_t *mixer)
+{
+	mixer_sched_t *sched = &mixer->sched;
+
+	sched->osc.handle = mixer;
+	sched->osc.osc2frames = _mixer_osc2frames;
+	sched->osc.frames2osc = _mixer_frames2osc;
+	sched->rate = mixer->sample_rate;
+}
+
+// relate wall clock to JACK frame time at start of current cycle
+static inline void
+_mixer_sched_cycle(mixer_app_t *mixer, jack_nframes_t nframes)
+{
+	mixer_sched_t *sched = &mixer->sched;
+	jack_nframes_t frames;
+	jack_time_t usecs;
+	jack_time_t next_usecs;
+	float period_usecs;
+	struct timespec ts;
+
+	if(  (jack_get_cycle_times(mixer->client, &frames, &usecs, &next_usecs, &period_usecs) != 0)
+		|| (clock_gettime(CLOCK_REALTIME, &ts) != 0) )
+	{
+		sched->frames = jack_last_frame_time(mixer->client);
+		return; // keep previous mapping
+	}
+
+	const jack_time_t elapsed = jack_get_time() - usecs; // since start of cycle
+	const uint64_t now = ((uint64_t)(ts.tv_sec + JAN_1970) << 32)
+		| (((uint64_t)ts.tv_nsec << 32) / 1000000000);
+
+	sched->frames = frames;
+	sched->timetag = now - (((uint64_t)elapsed << 32) / 1000000);
+	if(next_usecs > usecs)
+		sched->rate = nframes * 1e6 / (next_usecs - usecs);
+}
+
+static inline bool
+_mixer_sched_less(const mixer_sched_item_t *a, const mixer_sched_item_t *b)
+{
+	const int32_t dt = a->frame - b->frame; // wrap-around safe
+
+	if(dt != 0)
+		return dt < 0;
+
+	return (int32_t)(a->seq - b->seq) < 0;
+}
+
+static inline void
+_mixer_sched_push(mixer_app_t *mixer, jack_nframes_t frame, unsigned j,
+	unsigned i, int32_t mBFS)
+{
+	mixer_sched_t *sched = &mixer->sched;
+
+	if(sched->n == MIXER_SCHED_MAX) // full, drop
+		return;
+
+	const mixer_sched_item_t x = {
+		.frame = frame,
+		.seq = sched->seq++,
+		.source = j,
+		.sink = i,
+		.mBFS = mBFS
+	};
+
+	unsigned k = sched->n++;
+	while(k > 0)
 	{
-		_osc_message_handle(mixer, &reader);
+		const unsigned p = (k - 1) / 2;
+
+		if(!_mixer_sched_less(&x, &sched->items[p]))
+			break;
+
+		sched->items[k] = sched->items[p];
+		k = p;
+	}
+
+	sched->items[k] = x;
+}
+
+static inline void
+_mixer_sched_pop(mixer_app_t *mixer)
+{
+	mixer_sched_t *sched = &mixer->sched;
+	const mixer_sched_item_t x = sched->items[--sched->n];
+	const unsigned n = sched->n;
+	unsigned k = 0;
+
+	while(true)
+	{
+		unsigned c = 2*k + 1;
+
+		if(c >= n)
+			break;
+
+		if( (c + 1 < n) && _mixer_sched_less(&sched->items[c + 1], &sched->items[c]) )
+			c += 1;
+
+		if(!_mixer_sched_less(&sched->items[c], &x))
+			break;
+
+		sched->items[k] = sched->items[c];
+		k = c;
+	}
+
+	sched->items[k] = x;
+}
+
+// whether next scheduled change is due before given frame of current cycle
+static inline bool
+_mixer_sched_due(mixer_app_t *mixer, jack_nframes_t to, jack_nframes_t *at)
+{
+	mixer_sched_t *sched = &mixer->sched;
+
+	if(sched->n == 0)
+		return false;
+
+	const int32_t dt = sched->items[0].frame - sched->frames;
+	if(dt >= (int32_t)to)
+		return false;
+
+	*at = (dt < 0) ? 0 : dt; // overdue changes apply right away
+	return true;
+}
+
+static inline void
+_mixer_sched_apply(mixer_app_t *mixer)
+{
+	const mixer_sched_item_t *item = &mixer->sched.items[0];
+
+	_mixer_gain_set(mixer, item->source, item->sink, item->mBFS);
+	_mixer_sched_pop(mixer);
+}
+
+// set gain at given frame offset of current cycle, deferred if not yet due
+static inline void
+_mixer_gain_at(mixer_app_t *mixer, jack_nframes_t now, double offset,
+	unsigned j, unsigned i, int32_t mBFS)
+{
+	if(offset < now + 1)
+		_mixer_gain_set(mixer, j, i, mBFS);
+	else if(offset < 0x40000000) // keep clear of frame time wrap-around
+		_mixer_sched_push(mixer, mixer->sched.frames + (jack_nframes_t)offset, j, i, mBFS);
+}
+
+#include <osc.lv2/reader.h>
+
+static inline void
+_osc_message_handle(mixer_app_t *mixer, LV2_OSC_Reader *reader,
+	jack_nframes_t now, uint64_t timetag)
+{
+	const char *path = NULL;
+	const char *type= NULL;
+	mixer_shm_t *shm = mixer->shm;
+	const unsigned ncols = _mixer_shm_ncols(shm);
+
+	lv2_osc_reader_get_string(reader, &path);
+	if(!path)
+		return;
+
+	lv2_osc_reader_get_string(reader, &type);
+	if(!type)
+		return;
+
+	const double offset = mixer->sched.osc.osc2frames(mixer->sched.osc.handle, timetag);
+
+	if(!strcmp(path, "/patchmatrix/mixer"))
+	{
+		if(strcmp(type, ",iif"))
+			return;
+
+		int32_t nsink = 0;
+		int32_t nsource = 0;
+		float mBFS = 0.f;
+
+		lv2_osc_reader_get_int32(reader, &nsink);
+		lv2_osc_reader_get_int32(reader, &nsource);
+		lv2_osc_reader_get_float(reader, &mBFS);
+
+		if( (nsource < 0) || ((unsigned)nsource >= shm->nsources)
+			|| (nsink < 0) || ((unsigned)nsink >= ncols) )
+		{
+			return;
+		}
+
+		_mixer_gain_at(mixer, now, offset, nsource, nsink, mBFS);
+	}
+	else if(!strcmp(path, "/patchmatrix/mixer/row"))
+	{
+		// ,i[f...] or ,if... with one gain per sink, starting at first
+		if(strncmp(type, ",i", 2))
+			return;
+
+		const char *t = &type[2];
+		if(*t == '[')
+			t++;
+
+		int32_t nsource = 0;
+
+		lv2_osc_reader_get_int32(reader, &nsource);
+		if( (nsource < 0) || ((unsigned)nsource >= shm->nsources) )
+			return;
+
+		for(unsigned i = 0; (*t == 'f') && (i < ncols); t++, i++)
+		{
+			float mBFS = 0.f;
+
+			if(!lv2_osc_reader_get_float(reader, &mBFS))
+				return;
+
+			_mixer_gain_at(mixer, now, offset, nsource, i, mBFS);
+		}
+	}
+}
+
+static inline void
+_osc_packet_handle(mixer_app_t *mixer, const uint8_t *body, size_t size,
+	jack_nframes_t now, uint64_t timetag)
+{
+	LV2_OSC_Reader reader;
+	lv2_osc_reader_initialize(&reader, body, size);
+
+	if(lv2_osc_reader_is_bundle(&reader))
+	{
+		OSC_READER_BUNDLE_FOREACH(&reader, itm, size)
+		{
+			_osc_packet_handle(mixer, itm->body, itm->size, now, itm->timetag);
+		}
+	}
+	else if(lv2_osc_reader_is_message(&reader))
+	{
+		_osc_message_handle(mixer, &reader, now, timetag);
+	}
+}
+
+// whether packet is or contains a message with matching address
+static bool
+_osc_packet_filter(const osc_pattern_t *pat, const uint8_t *body, size_t size)
+{
+	LV2_OSC_Reader reader;
+	lv2_osc_reader_initialize(&reader, body, size);
+
+	if(lv2_osc_reader_is_bundle(&reader))
+	{
+		OSC_READER_BUNDLE_FOREACH(&reader, itm, size)
+		{
+			if(_osc_packet_filter(pat, itm->body, itm->size))
+				return true;
+		}
+	}
+	else if(lv2_osc_reader_is_message(&reader))
+	{
+		const char *path = NULL;
+
+		lv2_osc_reader_get_string(&reader, &path);
+		if(path)
+			return _osc_pattern_match(pat, path);
+	}
+
+	return false;
+}
+
+static inline void
+_autom_handle(mixer_app_t *mixer, jack_midi_event_t *ev)
+{
+	const uint8_t first = ev->buffer[0];
+
+	if(first & 0x80)
+	{
+		_midi_handle(mixer, ev->buffer, ev->size);
+	}
+	else
+	{
+		_osc_packet_handle(mixer, ev->buffer, ev->size, ev->time, LV2_OSC_IMMEDIATE);
+	}
+}
+
+// returns true when some cell has faded out
+static bool
+_audio_mixer_process_rows(mixer_app_t *mixer, jack_nframes_t from,
+	jack_nframes_t to, unsigned j0, unsigned j1)
+{
+	const dsp_t *dsp = &mixer->dsp;
+	float **psources = (float **)mixer->buf.sources;
+	const float **psinks = (const float **)mixer->buf.sinks;
+	const uint32_t nframes = to - from;
+	const mixer_live_t *live = &mixer->live;
+	bool dirty = false;
+
+	for(unsigned j = j0; j < j1; j++)
+	{
+		float *dst = &psources[j][from];
+		const unsigned *idx = &live->idxs[live->offs[j]];
+		const unsigned *end = &live->idxs[live->offs[j + 1]];
+
+		if(idx == end) // silent output
+		{
+			memset(dst, 0x0, nframes*sizeof(float));
+			continue;
+		}
+
+		mixer_cell_t *cells = _mixer_cell(mixer, j, 0);
+		bool cleared = false; // first contribution overwrites, no need to clear
+
+		for( ; idx < end; idx++)
+		{
+			const unsigned i = *idx;
+			mixer_cell_t *cell = &cells[i];
+			const float *src = &psinks[i][from];
+			uint32_t k = 0;
+
+			if(cell->ramp) // sample-accurate fade towards target
+			{
+				k = (cell->ramp < nframes) ? cell->ramp : nframes;
+
+				if(cleared)
+					dsp->ramp_add(dst, src, cell->gain, cell->step, k);
+				else
+					dsp->ramp_set(dst, src, cell->gain, cell->step, k);
+
+				cell->ramp -= k;
+				cell->gain = cell->ramp
+					? cell->gain + k*cell->step
+					: cell->target;
+			}
+
+			if(k < nframes)
+			{
+				if(!cleared)
+					dsp->mix_set(&dst[k], &src[k], cell->gain, nframes - k);
+				else if(cell->gain != 0.f) // multiply-add
+					dsp->mix_add(&dst[k], &src[k], cell->gain, nframes - k);
+			}
+
+			cleared = true;
+
+			if(!_mixer_cell_active(cell)) // has faded out, drop from next segment on
+				dirty = true;
+		}
+	}
+
+	return dirty;
+}
+
+static void *
+_mixer_worker(void *data)
+{
+	mixer_worker_t *worker = data;
+	mixer_app_t *mixer = worker->mixer;
+	mixer_pool_t *pool = &mixer->pool;
+
+	while(true)
+	{
+		if(sem_wait(&worker->go) == -1)
+			continue; // interrupted
+
+		if(atomic_load_explicit(&pool->quit, memory_order_relaxed))
+			break;
+
+		worker->dirty = _audio_mixer_process_rows(mixer, pool->from, pool->to,
+			pool->bounds[worker->part], pool->bounds[worker->part + 1]);
+
+		sem_post(&pool->done);
+	}
+
+	return NULL;
+}
+
+static void
+_mixer_pool_start(mixer_app_t *mixer)
+{
+	mixer_pool_t *pool = &mixer->pool;
+	const int prio = jack_client_real_time_priority(mixer->client);
+	const int rt = jack_is_realtime(mixer->client);
+
+	atomic_init(&pool->quit, false);
+	sem_init(&pool->done, 0, 0);
+
+	for(unsigned w = 0; w < pool->nthreads - 1; w++)
+	{
+		mixer_worker_t *worker = &pool->workers[w];
+
+		worker->mixer = mixer;
+		worker->part = w + 1; // process callback thread sums first part itself
+		sem_init(&worker->go, 0, 0);
+
+		if(jack_client_create_thread(mixer->client, &worker->thread, prio, rt,
+			_mixer_worker, worker) != 0)
+		{
+			sem_destroy(&worker->go);
+			break;
+		}
+
+		pool->nworkers += 1;
+	}
+
+	if(pool->nworkers < pool->nthreads - 1)
+		fprintf(stderr, "Could only start %u of %u worker threads.\n",
+			pool->nworkers, pool->nthreads - 1);
+
+	// left over parts are summed by process callback thread
+}
+
+static void
+_mixer_pool_stop(mixer_app_t *mixer)
+{
+	mixer_pool_t *pool = &mixer->pool;
+
+	atomic_store_explicit(&pool->quit, true, memory_order_relaxed);
+
+	for(unsigned w = 0; w < pool->nworkers; w++)
+	{
+		mixer_worker_t *worker = &pool->workers[w];
+
+		sem_post(&worker->go);
+		jack_client_stop_thread(mixer->client, worker->thread);
+		sem_destroy(&worker->go);
+	}
+
+	pool->nworkers = 0;
+	sem_destroy(&pool->done);
+}
+
+static inline void
+_audio_mixer_process_internal(mixer_app_t *mixer, jack_nframes_t from,
+	jack_nframes_t to)
+{
+	mixer_shm_t *shm = mixer->shm;
+	mixer_pool_t *pool = &mixer->pool;
+
+	if(from == to)
+	{
+		return; // shortcut
+	}
+
+	_mixer_gains_sync(mixer);
+
+	if(mixer->live.dirty)
+		_mixer_live_rebuild(mixer);
+
+	const unsigned ncells = mixer->live.offs[shm->nsources];
+
+	if( !pool->nworkers || (ncells < pool->nthreads * MIXER_THREAD_CELLS) )
+	{
+		if(_audio_mixer_process_rows(mixer, from, to, 0, shm->nsources))
+			mixer->live.dirty = true;
+
+		return;
+	}
+
+	pool->from = from;
+	pool->to = to;
+
+	for(unsigned w = 0; w < pool->nworkers; w++)
+		sem_post(&pool->workers[w].go);
+
+	bool dirty = _audio_mixer_process_rows(mixer, from, to,
+		pool->bounds[0], pool->bounds[1]);
+
+	// parts without a running worker
+	if(pool->nworkers + 1 < pool->nthreads)
+	{
+		dirty |= _audio_mixer_process_rows(mixer, from, to,
+			pool->bounds[pool->nworkers + 1], pool->bounds[pool->nthreads]);
+	}
+
+	for(unsigned w = 0; w < pool->nworkers; w++)
+	{
+		while(sem_wait(&pool->done) == -1)
+		{
+			// interrupted
+		}
+	}
+
+	for(unsigned w = 0; w < pool->nworkers; w++)
+		dirty |= pool->workers[w].dirty;
+
+	if(dirty)
+		mixer->live.dirty = true;
+}
+
+#ifdef JACK_HAS_METADATA_API
+static inline void
+_cv_mixer_process_internal(mixer_app_t *mixer, jack_nframes_t from,
+	jack_nframes_t to)
+{
+	mixer_shm_t *shm = mixer->shm;
+	float **psources = (float **)mixer->buf.sources;
+
+	// summing is DC-accurate already, as unity gains are exact
+	_audio_mixer_process_internal(mixer, from, to);
+
+	for(unsigned j = 0; j < shm->nsources; j++)
+	{
+		const float offset = _mixer_cell(mixer, j, shm->nsinks)->gain;
+
+		if(offset == 0.f)
+			continue;
+
+		float *dst = &psources[j][from];
+
+		for(uint32_t k = 0; k < to - from; k++)
+			dst[k] += offset;
+	}
+}
+#endif
+
+// render up to scheduled changes due before given frame, apply them in between
+static inline jack_nframes_t
+_mixer_sched_process(mixer_app_t *mixer, jack_nframes_t from, jack_nframes_t to,
+	void (*process_internal)(mixer_app_t *mixer, jack_nframes_t from, jack_nframes_t to))
+{
+	jack_nframes_t at;
+
+	while(_mixer_sched_due(mixer, to, &at))
+	{
+		if(at > from)
+		{
+			process_internal(mixer, from, at);
+			from = at;
+		}
+
+		_mixer_sched_apply(mixer);
+	}
+
+	return from;
+}
+
+static inline int
+_mixer_process(jack_nframes_t nframes, mixer_app_t *mixer,
+	void (*process_internal)(mixer_app_t *mixer, jack_nframes_t from, jack_nframes_t to))
+{
+	mixer_shm_t *shm = mixer->shm;
+
+	if(  atomic_load_explicit(&closed, memory_order_relaxed)
+		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
+	{
+		return 0;
+	}
+
+	void **psources = mixer->buf.sources;
+	void **psinks = mixer->buf.sinks;
+	void *pautom;
+
+	for(unsigned i = 0; i < shm->nsinks; i++)
+	{
+		jack_port_t *jsink = mixer->jsinks[i];
+		psinks[i] = jack_port_get_buffer(jsink, nframes);
+	}
+
+	for(unsigned j = 0; j < shm->nsources; j++)
+	{
+		jack_port_t *jsource = mixer->jsources[j];
+		psources[j] = jack_port_get_buffer(jsource, nframes);
+	}
+
+	pautom = jack_port_get_buffer(mixer->jautom, nframes);
+	const unsigned count = jack_midi_get_event_count(pautom);
+	jack_nframes_t from = 0;
+
+	_mixer_sched_cycle(mixer, nframes);
+
+	for(unsigned p = 0; p < count; p++)
+	{
+			jack_midi_event_t ev;
+			jack_midi_event_get(&ev, pautom, p);
+
+			from = _mixer_sched_process(mixer, from, ev.time, process_internal);
+			process_internal(mixer, from, ev.time);
+			_autom_handle(mixer, &ev);
+
+			from = ev.time;
+	}
+
+	from = _mixer_sched_process(mixer, from, nframes, process_internal);
+	process_internal(mixer, from, nframes);
+
+	return 0;
+}
+
+static int
+_audio_mixer_process(jack_nframes_t nframes, void *arg)
+{
+	return _mixer_process(nframes, arg, _audio_mixer_process_internal);
+}
+
+#ifdef JACK_HAS_METADATA_API
+static int
+_cv_mixer_process(jack_nframes_t nframes, void *arg)
+{
+	return _mixer_process(nframes, arg, _cv_mixer_process_internal);
+}
+#endif
+
+static inline bool
+_midi_heap_less(mixer_app_t *mixer, unsigned a, unsigned b)
+{
+	const jack_nframes_t ta = mixer->buf.evs[a].time;
+	const jack_nframes_t tb = mixer->buf.evs[b].time;
+
+	if(ta != tb)
+		return ta < tb;
+
+	return a > b; // ties go to higher inputs, e.g. automation before sinks
+}
+
+static inline void
+_midi_heap_down(mixer_app_t *mixer, unsigned n, unsigned k)
+{
+	unsigned *heap = mixer->buf.heap;
+	const unsigned x = heap[k];
+
+	while(true)
+	{
+		unsigned c = 2*k + 1;
+
+		if(c >= n)
+			break;
+
+		if( (c + 1 < n) && _midi_heap_less(mixer, heap[c + 1], heap[c]) )
+			c += 1;
+
+		if(!_midi_heap_less(mixer, heap[c], x))
+			break;
+
+		heap[k] = heap[c];
+		k = c;
+	}
+
+	heap[k] = x;
+}
+
+static inline int
+_event_mixer_process(jack_nframes_t nframes, mixer_app_t *mixer, bool is_osc)
+{
+	mixer_shm_t *shm = mixer->shm;
+
+	if(  atomic_load_explicit(&closed, memory_order_relaxed)
+		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
+	{
+		return 0;
+	}
+
+	void **psources = mixer->buf.sources;
+	void **psinks = mixer->buf.sinks;
+
+	unsigned *count = mixer->buf.count;
+	unsigned *pos = mixer->buf.pos;
+	jack_midi_event_t *evs = mixer->buf.evs;
+	unsigned *heap = mixer->buf.heap;
+	unsigned n = 0;
+
+	for(unsigned i = 0; i < shm->nsinks; i++)
+	{
+		jack_port_t *jsink = mixer->jsinks[i];
+		psinks[i] = jack_port_get_buffer(jsink, nframes);
+	}
+
+	psinks[shm->nsinks] = jack_port_get_buffer(mixer->jautom, nframes);
+
+	for(unsigned i = 0; i < shm->nsinks + 1; i++)
+	{
+		count[i] = jack_midi_get_event_count(psinks[i]);
+		pos[i] = 0;
+
+		if(count[i] == 0) // nothing to merge from this input
+			continue;
+
+		jack_midi_event_get(&evs[i], psinks[i], 0);
+		heap[n++] = i;
+	}
+
+	for(unsigned k = n/2; k > 0; k--)
+		_midi_heap_down(mixer, n, k - 1);
+
+	for(unsigned j = 0; j < shm->nsources; j++)
+	{
+		jack_port_t *jsource = mixer->jsources[j];
+		psources[j] = jack_port_get_buffer(jsource, nframes);
+
+		// clear
+		jack_midi_clear_buffer(psources[j]);
+	}
+
+	_mixer_gains_sync(mixer);
+	_mixer_sched_cycle(mixer, nframes);
+
+	jack_nframes_t at;
+	while(n > 0) // k-way merge of all inputs in time order
+	{
+		const unsigned I = heap[0];
+		jack_midi_event_t ev = evs[I];
+
+		while(_mixer_sched_due(mixer, ev.time + 1, &at)) // scheduled up to now
+			_mixer_sched_apply(mixer);
+
+		if(I == shm->nsinks) // automation port
+		{
+			_autom_handle(mixer, &ev);
+		}
+		else
+		{
+			if(mixer->live.dirty) // automation changed routes
+				_mixer_live_rebuild(mixer);
+
+			const mixer_live_t *live = &mixer->live;
+
+			for(unsigned k = live->offs[I]; k < live->offs[I + 1]; k++)
+			{
+				const unsigned j = live->idxs[k];
+				const mixer_cell_t *cell = _mixer_cell(mixer, j, I);
+				const float gain = cell->target; // events are not ramped
+
+				if(gain != 0.f) // connection to be mixed
+				{
+					if(  is_osc && cell->filter
+						&& !_osc_packet_filter(cell->filter, ev.buffer, ev.size) )
+					{
+						continue;
+					}
+
+					uint8_t *msg = jack_midi_event_reserve(psources[j], ev.time, ev.size);
+					if(!msg)
+						continue;
+
+					memcpy(msg, ev.buffer, ev.size);
+
+					if( !is_osc && (gain != 1.f) && (ev.size == 3) ) // multiply-add
+					{
+						const uint8_t cmd = msg[0] & 0xf0;
+						if( (cmd == 0x90) || (cmd == 0x80) ) // noteOn or noteOff
+						{
+							const float vel = msg[2] * gain; // velocity
+							msg[2] = vel < 0 ? 0 : (vel > 0x7f ? 0x7f : vel);
+						}
+					}
+				}
+				// else connection not to be mixed
+			}
+		}
+
+		pos[I] += 1; // advance event pointer from this sink
+
+		if(pos[I] < count[I]) // refill from same input
+			jack_midi_event_get(&evs[I], psinks[I], pos[I]);
+		else // input is drained
+			heap[0] = heap[--n];
+
+		_midi_heap_down(mixer, n, 0);
+	}
+
+	while(_mixer_sched_due(mixer, nframes, &at)) // remainder of cycle
+		_mixer_sched_apply(mixer);
+
+	return 0;
+}
+
+static int
+_midi_mixer_process(jack_nframes_t nframes, void *arg)
+{
+	return _event_mixer_process(nframes, arg, false);
+}
+
+#ifdef JACK_HAS_METADATA_API
+static int
+_osc_mixer_process(jack_nframes_t nframes, void *arg)
+{
+	return _event_mixer_process(nframes, arg, true);
+}
+#endif
+
+static void
+_mixer_dealloc(mixer_app_t *mixer)
+{
+	free(mixer->jsinks);
+	free(mixer->jsources);
+	free(mixer->cells);
+	free(mixer->live.offs);
+	free(mixer->live.idxs);
+	free(mixer->buf.sinks);
+	free(mixer->buf.sources);
+	free(mixer->buf.count);
+	free(mixer->buf.pos);
+	free(mixer->buf.evs);
+	free(mixer->buf.heap);
+	free(mixer->filters);
+	free(mixer->pool.workers);
+	free(mixer->pool.bounds);
+	free(mixer->name);
+}
+
+// map shm of given name and register ports, prefixed when hosted by engine
+static int
+_mixer_init(mixer_app_t *mixer, const char *name, const char *prefix,
+	unsigned nsinks, unsigned nsources, unsigned ramp_ms)
+{
+	const size_t total_size = _mixer_shm_size(nsinks, nsources);
+	const unsigned stride = _shm_stride(nsinks + 1); // room for CV offset
+
+	mixer->nsinks = nsinks;
+	mixer->nsources = nsources;
+	mixer->name = strdup(name);
+	mixer->jsinks = calloc(nsinks, sizeof(jack_port_t *));
+	mixer->jsources = calloc(nsources, sizeof(jack_port_t *));
+	mixer->cells = calloc(nsources*stride, sizeof(mixer_cell_t));
+	mixer->live.offs = calloc((nsinks > nsources ? nsinks : nsources) + 1, sizeof(unsigned));
+	mixer->live.idxs = calloc(nsources*nsinks, sizeof(unsigned));
+	mixer->buf.sinks = calloc(nsinks + 1, sizeof(void *));
+	mixer->buf.sources = calloc(nsources, sizeof(void *));
+	mixer->buf.count = calloc(nsinks + 1, sizeof(unsigned));
+	mixer->buf.pos = calloc(nsinks + 1, sizeof(unsigned));
+	mixer->buf.evs = calloc(nsinks + 1, sizeof(jack_midi_event_t));
+	mixer->buf.heap = calloc(nsinks + 1, sizeof(unsigned));
+	mixer->pool.workers = calloc(mixer->pool.nthreads, sizeof(mixer_worker_t));
+	mixer->pool.bounds = calloc(mixer->pool.nthreads + 1, sizeof(unsigned));
+	if(  !mixer->name || !mixer->jsinks || !mixer->jsources || !mixer->cells
+		|| !mixer->live.offs || !mixer->live.idxs
+		|| !mixer->buf.sinks || !mixer->buf.sources || !mixer->buf.count || !mixer->buf.pos
+		|| !mixer->buf.evs || !mixer->buf.heap
+		|| !mixer->pool.workers || !mixer->pool.bounds)
+	{
+		return -1;
+	}
+
+	mixer->sample_rate = jack_get_sample_rate(mixer->client);
+	_mixer_ramp_set(mixer, ramp_ms);
+	_mixer_sched_init(mixer);
+
+	const int fd = shm_open(name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if(fd == -1)
+		return -1;
+
+	if(ftruncate(fd, total_size) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+
+	mixer_shm_t *shm = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(shm == MAP_FAILED)
+		return -1;
+
+	if(sem_init(&shm->done, 1, 0) == -1)
+	{
+		munmap(shm, total_size);
+		return -1;
+	}
+
+	mixer->shm = shm;
+
+	shm->hdr.size = total_size;
+	shm->nsinks = nsinks;
+	shm->nsources = nsources;
+	shm->stride = stride;
+	shm->type = mixer->type;
+	shm->ring = _mixer_shm_ring_offset(nsinks, nsources);
+
+	atomic_init(&shm->closing, false);
+	atomic_init(&shm->locked, false);
+	atomic_init(&shm->resync, false);
+	atomic_init(&shm->seq, 0);
+	varchunk_init(_mixer_shm_ring(shm), MIXER_RING_SIZE, true);
+
+#ifdef JACK_HAS_METADATA_API
+	const int32_t unity = (mixer->type == TYPE_CV) ? GAIN_UNITY_CV : 0;
+#else
+	const int32_t unity = 0;
+#endif
+
+	for(unsigned j = 0; j < nsources; j++)
+	{
+		for(unsigned i = 0; i < nsinks; i++)
+		{
+			if(j == i)
+				atomic_init(_mixer_shm_gain(shm, j, i), unity);
+			else
+				atomic_init(_mixer_shm_gain(shm, j, i), GAIN_MIN);
+		}
+
+		atomic_init(_mixer_shm_gain(shm, j, nsinks), 0); // CV offset
+	}
+
+	// filtered connections are routed from the start
+	for(unsigned f = 0; f < mixer->nfilters; f++)
+	{
+		const mixer_filter_t *filter = &mixer->filters[f];
+
+		if( (filter->source < nsources) && (filter->sink < nsinks) )
+		{
+			atomic_init(_mixer_shm_gain(shm, filter->source, filter->sink), unity);
+			_mixer_cell(mixer, filter->source, filter->sink)->filter = &filter->pattern;
+		}
+	}
+
+	_dsp_init(&mixer->dsp);
+	_gain_init();
+	_mixer_gains_refresh(mixer, false);
+	_mixer_live_rebuild(mixer);
+
+	// layout is complete, let UI map it as soon as ports show up
+	atomic_store_explicit(&shm->hdr.version, SHM_VERSION, memory_order_release);
+
+	const char *port_type = _mixer_events(mixer)
+		? JACK_DEFAULT_MIDI_TYPE
+		: JACK_DEFAULT_AUDIO_TYPE;
+	char port_name [128];
+	unsigned i;
+
+	for(i = 0; i < nsinks; i++)
+	{
+		snprintf(port_name, sizeof(port_name), "%ssink_%02u", prefix, i + 1);
+
+		jack_port_t *jsink = jack_port_register(mixer->client, port_name,
+			port_type, JackPortIsInput, 0);
+		if(!jsink)
+			return -1;
+
+#ifdef JACK_HAS_METADATA_API
+		jack_uuid_t uuid = jack_port_uuid(jsink);
+		char buf [32];
+
+		snprintf(buf, 32, "%u", i);
+		jack_set_property(mixer->client, uuid, JACKEY_ORDER, buf, XSD__integer);
+
+		if(mixer->type == TYPE_MIDI)
+			jack_set_property(mixer->client, uuid, JACKEY_EVENT_TYPES, "MIDI", "text/plain");
+		else if(mixer->type == TYPE_OSC)
+			jack_set_property(mixer->client, uuid, JACKEY_EVENT_TYPES, "OSC", "text/plain");
+		else if(mixer->type == TYPE_CV)
+			jack_set_property(mixer->client, uuid, JACKEY_SIGNAL_TYPE, "CV", "text/plain");
+
+		snprintf(buf, 32, "Sink %u", i + 1);
+		jack_set_property(mixer->client, uuid, JACK_METADATA_PRETTY_NAME, buf, "text/plain");
+#endif
+
+		mixer->jsinks[i] = jsink;
+	}
+
+	{
+		snprintf(port_name, sizeof(port_name), "%sautomation", prefix);
+
+		jack_port_t *jautom = jack_port_register(mixer->client, port_name,
+			JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+		if(!jautom)
+			return -1;
+
+#ifdef JACK_HAS_METADATA_API
+		jack_uuid_t uuid = jack_port_uuid(jautom);
+		char buf [32];
+
+		snprintf(buf, 32, "%u", i);
+		jack_set_property(mixer->client, uuid, JACKEY_ORDER, buf, XSD__integer);
+
+		jack_set_property(mixer->client, uuid, JACKEY_EVENT_TYPES, "MIDI,OSC", "text/plain");
+
+		jack_set_property(mixer->client, uuid, JACK_METADATA_PRETTY_NAME, "Automation", "text/plain");
+#endif
+
+		mixer->jautom = jautom;
+	}
+
+	for(unsigned j = 0; j < nsources; j++)
+	{
+		snprintf(port_name, sizeof(port_name), "%ssource_%02u", prefix, j + 1);
+
+		jack_port_t *jsource = jack_port_register(mixer->client, port_name,
+			port_type, JackPortIsOutput, 0);
+		if(!jsource)
+			return -1;
+
+#ifdef JACK_HAS_METADATA_API
+		jack_uuid_t uuid = jack_port_uuid(jsource);
+		char buf [32];
+
+		snprintf(buf, 32, "%u", j);
+		jack_set_property(mixer->client, uuid, JACKEY_ORDER, buf, XSD__integer);
+
+		if(mixer->type == TYPE_MIDI)
+			jack_set_property(mixer->client, uuid, JACKEY_EVENT_TYPES, "MIDI", "text/plain");
+		else if(mixer->type == TYPE_OSC)
+			jack_set_property(mixer->client, uuid, JACKEY_EVENT_TYPES, "OSC", "text/plain");
+		else if(mixer->type == TYPE_CV)
+			jack_set_property(mixer->client, uuid, JACKEY_SIGNAL_TYPE, "CV", "text/plain");
+
+		snprintf(buf, 32, "Source %u", j + 1);
+		jack_set_property(mixer->client, uuid, JACK_METADATA_PRETTY_NAME, buf, "text/plain");
+#endif
+
+		mixer->jsources[j] = jsource;
+	}
+
+	return 0;
+}
+
+static void
+_mixer_port_unregister(mixer_app_t *mixer, jack_port_t *jport)
+{
+	if(!jport)
+		return;
+
+#ifdef JACK_HAS_METADATA_API
+	jack_uuid_t uuid = jack_port_uuid(jport);
+	jack_remove_properties(mixer->client, uuid);
+#endif
+	jack_port_unregister(mixer->client, jport);
+}
+
+// undo whatever _mixer_init got done
+static void
+_mixer_deinit(mixer_app_t *mixer)
+{
+	for(unsigned i = 0; mixer->jsinks && (i < mixer->nsinks); i++)
+		_mixer_port_unregister(mixer, mixer->jsinks[i]);
+
+	_mixer_port_unregister(mixer, mixer->jautom);
+
+	for(unsigned j = 0; mixer->jsources && (j < mixer->nsources); j++)
+		_mixer_port_unregister(mixer, mixer->jsources[j]);
+
+	if(mixer->shm)
+	{
+		sem_destroy(&mixer->shm->done);
+		munmap(mixer->shm, mixer->shm->hdr.size);
+		mixer->shm = NULL;
+	}
+
+	if(mixer->name)
+		shm_unlink(mixer->name);
+}
+
+static JackProcessCallback
+_mixer_process_callback(mixer_app_t *mixer)
+{
+	switch(mixer->type)
+	{
+		case TYPE_AUDIO:
+			return _audio_mixer_process;
+#ifdef JACK_HAS_METADATA_API
+		case TYPE_CV:
+			return _cv_mixer_process;
+		case TYPE_OSC:
+			return _osc_mixer_process;
+#endif
+		default:
+			return _midi_mixer_process;
 	}
 }
 
-static inline void
-_autom_handle(mixer_app_t *mixer, jack_midi_event_t *ev)
+#ifdef PATCHMATRIX_UNIT
+static void
+_mixer_unit_free(void *data)
 {
-	const uint8_t first = ev->buffer[0];
+	mixer_app_t *mixer = data;
 
-	if(first & 0x80)
-	{
-		_midi_handle(mixer, ev);
-	}
-	else
-	{
-		_osc_packet_handle(mixer, ev->buffer, ev->size);
-	}
+	_mixer_deinit(mixer);
+	_mixer_dealloc(mixer);
+	free(mixer);
 }
 
-static inline void
-_audio_mixer_process_internal(mixer_app_t *mixer,
-	float *psources [PORT_MAX], const float *psinks [PORT_MAX],
-	jack_nframes_t from, jack_nframes_t to)
+bool
+_mixer_unit_new(unit_t *unit, jack_client_t *client, port_type_t type,
+	unsigned nsinks, unsigned nsources)
 {
-	mixer_shm_t *shm = mixer->shm;
+	mixer_app_t *mixer = calloc(1, sizeof(mixer_app_t));
+	if(!mixer)
+		return false;
 
-	if(from == to)
+	mixer->client = client;
+	mixer->type = type;
+	mixer->pool.nthreads = 1; // engine process callback is shared by all units
+
+	char prefix [ENGINE_NAME_SIZE + 1];
+	snprintf(prefix, sizeof(prefix), "%s/", unit->name);
+
+	if(_mixer_init(mixer, unit->name, prefix, nsinks, nsources, 10) != 0)
 	{
-		return; // shortcut
+		_mixer_unit_free(mixer);
+		return false;
 	}
 
-	for(unsigned j = 0; j < shm->nsources; j++)
-	{
-		for(unsigned i = 0; i < shm->nsinks; i++)
-		{
-			const int32_t mBFS = atomic_load_explicit(&shm->jgains[j][i], memory_order_relaxed);
-			const float dBFS = mBFS / 100.f;
+	unit->data = mixer;
+	unit->process = _mixer_process_callback(mixer);
+	unit->free = _mixer_unit_free;
+	unit->done = &mixer->shm->done;
+	unit->closing = &mixer->shm->closing;
 
-			if(dBFS == 0.f) // just add
-			{
-				for(unsigned k = from; k < to; k++)
-				{
-					psources[j][k] += psinks[i][k];
-				}
-			}
-			else if(dBFS > -36.f) // multiply-add
-			{
-				const float gain = exp10f(dBFS / 20.f); // jgain = 20.f*log10f(gain);
+	return true;
+}
+#else
+static atomic_bool zygote_done = ATOMIC_VAR_INIT(false);
 
-				for(unsigned k = from; k < to; k++)
-				{
-					psources[j][k] += gain * psinks[i][k];
-				}
-			}
-			// else connection not to be mixed
-		}
-	}
+static void
+_zygote_interrupt(int signum)
+{
+	atomic_store_explicit(&zygote_done, true, memory_order_relaxed);
 }
 
-static int
-_audio_mixer_process(jack_nframes_t nframes, void *arg)
+static void
+_zygote_on_info_shutdown_cb(jack_status_t code, const char *reason, void *arg)
 {
-	mixer_app_t *mixer = arg;
-	mixer_shm_t *shm = mixer->shm;
+	_exit(0); // warm mixer has nothing to tear down yet
+}
 
-	if(  atomic_load_explicit(&closed, memory_order_relaxed)
-		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
-	{
-		return 0;
-	}
+static jack_client_t *
+_mixer_client_open(const char *server_name)
+{
+	jack_options_t opts = JackNullOption | JackNoStartServer;
+	if(server_name)
+		opts |= JackServerName;
 
-	float *psources [PORT_MAX];
-	const float *psinks [PORT_MAX];
-	void *pautom;
+	jack_status_t status;
+	return jack_client_open(PATCHMATRIX_MIXER_ID, opts, &status,
+		server_name ? server_name : NULL);
+}
 
-	for(unsigned i = 0; i < shm->nsinks; i++)
+static bool
+_zygote_req_valid(const zygote_req_t *req)
+{
+	switch(req->port_type)
 	{
-		jack_port_t *jsink = mixer->jsinks[i];
-		psinks[i] = jack_port_get_buffer(jsink, nframes);
+		case TYPE_AUDIO:
+		case TYPE_MIDI:
+#ifdef JACK_HAS_METADATA_API
+		case TYPE_CV:
+		case TYPE_OSC:
+#endif
+			break;
+		default:
+			return false;
 	}
 
-	for(unsigned j = 0; j < shm->nsources; j++)
-	{
-		jack_port_t *jsource = mixer->jsources[j];
-		psources[j] = jack_port_get_buffer(jsource, nframes);
+	return (req->nsinks >= 1) && (req->nsinks <= PORT_MAX)
+		&& (req->nsources >= 1) && (req->nsources <= PORT_MAX);
+}
 
-		// clear
-		for(unsigned k = 0; k < nframes; k++)
-		{
-			psources[j][k] = 0.f;
-		}
-	}
+// open JACK client ahead of time, then wait for a single spawn request
+static int
+_zygote_warm(mixer_app_t *mixer, int sock, const char *server_name,
+	unsigned *nsinks, unsigned *nsources)
+{
+	mixer->client = _mixer_client_open(server_name);
+	if(!mixer->client)
+		return -1;
 
-	pautom = jack_port_get_buffer(mixer->jautom, nframes);
-	const unsigned count = jack_midi_get_event_count(pautom);
-	jack_nframes_t from = 0;
+	jack_on_info_shutdown(mixer->client, _zygote_on_info_shutdown_cb, mixer);
 
-	for(unsigned p = 0; p < count; p++)
+	while(true)
 	{
-			jack_midi_event_t ev;
-			jack_midi_event_get(&ev, pautom, p);
+		const int conn = accept(sock, NULL, NULL);
+		if(conn == -1)
+		{
+			if(errno == EINTR)
+				continue;
 
-			_audio_mixer_process_internal(mixer, psources, psinks, from, ev.time);
-			_autom_handle(mixer, &ev);
+			jack_client_close(mixer->client);
+			return -1;
+		}
 
-			from = ev.time;
+		zygote_req_t req;
+		const ssize_t len = recv(conn, &req, sizeof(req), 0);
+		close(conn);
+
+		if( (len == sizeof(req)) && _zygote_req_valid(&req) ) // ignore probes
+		{
+			mixer->type = req.port_type;
+			*nsinks = req.nsinks;
+			*nsources = req.nsources;
+			return 0;
+		}
 	}
+}
 
-	_audio_mixer_process_internal(mixer, psources, psinks, from, nframes);
+// a spawn server already serves this socket
+static bool
+_zygote_alive(const struct sockaddr_un *addr)
+{
+	const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if(fd == -1)
+		return false;
 
-	return 0;
+	const bool alive = connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) == 0;
+	close(fd);
+
+	return alive;
 }
 
+// pre-fork one warm mixer at a time, returns 0 in the one that got a request
 static int
-_midi_mixer_process(jack_nframes_t nframes, void *arg)
+_zygote_run(mixer_app_t *mixer, const char *server_name,
+	unsigned *nsinks, unsigned *nsources)
 {
-	mixer_app_t *mixer = arg;
-	mixer_shm_t *shm = mixer->shm;
-
-	if(  atomic_load_explicit(&closed, memory_order_relaxed)
-		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
-	{
-		return 0;
-	}
+	struct sockaddr_un addr;
+	_zygote_addr(&addr, server_name);
 
-	void *psources [PORT_MAX];
-	void *psinks [PORT_MAX + 1];
+	const int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if(sock == -1)
+		return -1;
 
-	unsigned count [PORT_MAX + 1];
-	unsigned pos [PORT_MAX + 1];
+	const mode_t mask = umask(0077); // /tmp fallback is shared with other users
+	int err = bind(sock, (const struct sockaddr *)&addr, sizeof(addr));
+	bool running = false;
 
-	for(unsigned i = 0; i < shm->nsinks; i++)
+	if( (err == -1) && (errno == EADDRINUSE) )
 	{
-		jack_port_t *jsink = mixer->jsinks[i];
-		psinks[i] = jack_port_get_buffer(jsink, nframes);
-
-		count[i] = jack_midi_get_event_count(psinks[i]);
-		pos[i] = 0;
+		if(!_runtime_addr_owned(&addr))
+			fprintf(stderr, "Refusing to use `%s' of another user.\n", addr.sun_path);
+		else if(_zygote_alive(&addr))
+			running = true;
+		else if(unlink(addr.sun_path) == 0) // take over socket of a crashed spawn server
+			err = bind(sock, (const struct sockaddr *)&addr, sizeof(addr));
 	}
 
+	umask(mask);
+
+	if(err == -1)
 	{
-		psinks[shm->nsinks] = jack_port_get_buffer(mixer->jautom, nframes);
-		count[shm->nsinks] = jack_midi_get_event_count(psinks[shm->nsinks]);
-		pos[shm->nsinks] = 0;
+		close(sock);
+		return running ? 1 : -1;
 	}
 
-	for(unsigned j = 0; j < shm->nsources; j++)
+	if(listen(sock, 16) == -1)
 	{
-		jack_port_t *jsource = mixer->jsources[j];
-		psources[j] = jack_port_get_buffer(jsource, nframes);
-
-		// clear
-		jack_midi_clear_buffer(psources[j]);
+		close(sock);
+		unlink(addr.sun_path);
+		return -1;
 	}
 
-	while(true)
-	{
-		uint32_t T = UINT32_MAX;
-		int I = -1;
+	struct sigaction sa;
+	memset(&sa, 0x0, sizeof(sa));
+	sigemptyset(&sa.sa_mask);
 
-		for(unsigned i = 0; i < shm->nsinks + 1; i++)
-		{
-			if(pos[i] >= count[i]) // no more events to process on this sink
-				continue;
+	sa.sa_handler = _zygote_interrupt; // no SA_RESTART, must interrupt read
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
 
-			jack_midi_event_t ev;
-			jack_midi_event_get(&ev, psinks[i], pos[i]);
+	sa.sa_handler = SIG_IGN;
+	sa.sa_flags = SA_NOCLDWAIT; // spawned mixers reap themselves
+	sigaction(SIGCHLD, &sa, NULL);
 
-			if(ev.time <= T)
-			{
-				T = ev.time;
-				I = i;
-			}
-		}
+	int ret = 1;
 
-		if(I < 0) // no more events to process from all sinks
+	while(!atomic_load_explicit(&zygote_done, memory_order_relaxed))
+	{
+		int taken [2];
+		if(pipe(taken) == -1)
+		{
+			ret = -1;
 			break;
+		}
 
-		jack_midi_event_t ev;
-		jack_midi_event_get(&ev, psinks[I], pos[I]);
-
-		if((unsigned)I == shm->nsinks) // automation port
+		const pid_t pid = fork();
+		if(pid == -1)
 		{
-			_autom_handle(mixer, &ev);
+			close(taken[0]);
+			close(taken[1]);
+			ret = -1;
+			break;
 		}
-		else
+
+		if(pid == 0) // warm mixer
 		{
-			for(unsigned j = 0; j < shm->nsources; j++)
-			{
-				const int32_t mBFS = atomic_load_explicit(&shm->jgains[j][I], memory_order_relaxed);
-				const float dBFS = mBFS / 100.f;
+			signal(SIGINT, SIG_DFL);
+			signal(SIGTERM, SIG_DFL);
+			signal(SIGCHLD, SIG_DFL);
+			close(taken[0]);
 
-				if(dBFS > -36.f) // connection to be mixed
-				{
-					uint8_t *msg = jack_midi_event_reserve(psources[j], ev.time, ev.size);
-					if(!msg)
-						continue;
+			if(_zygote_warm(mixer, sock, server_name, nsinks, nsources) != 0)
+				_exit(-1);
 
-					memcpy(msg, ev.buffer, ev.size);
+			// let spawn server fork the next warm mixer right away
+			if(write(taken[1], "", 1) == -1)
+				fprintf(stderr, "Spawn server gone.\n");
 
-					if( (dBFS != 0.f) && (ev.size == 3) ) // multiply-add
-					{
-						const uint8_t cmd = msg[0] & 0xf0;
-						if( (cmd == 0x90) || (cmd == 0x80) ) // noteOn or noteOff
-						{
-							const float gain = exp10f(dBFS / 20.f); // jgain = 20*log10(gain/1);
+			close(taken[1]);
+			close(sock);
 
-							const float vel = msg[2] * gain; // velocity
-							msg[2] = vel < 0 ? 0 : (vel > 0x7f ? 0x7f : vel);
-						}
-					}
-				}
-				// else connection not to be mixed
-			}
+			return 0;
 		}
 
-		pos[I] += 1; // advance event pointer from this sink
+		close(taken[1]);
+
+		char c;
+		ssize_t n;
+		while( ((n = read(taken[0], &c, 1)) == -1) && (errno == EINTR)
+			&& !atomic_load_explicit(&zygote_done, memory_order_relaxed) )
+		{}
+
+		close(taken[0]);
+
+		if(n != 1) // interrupted, or warm mixer lost its JACK server
+		{
+			kill(pid, SIGTERM);
+			break;
+		}
 	}
 
-	return 0;
+	close(sock);
+	unlink(addr.sun_path);
+
+	return ret;
 }
 
 int
 main(int argc, char **argv)
 {
 	static mixer_app_t mixer;
-	const size_t total_size = sizeof(mixer_shm_t);
 
 	const char *server_name = NULL;
 	unsigned nsinks = 1;
 	unsigned nsources = 1;
+	unsigned ramp_ms = 10;
+	bool zygote = false;
 	mixer.type = TYPE_AUDIO;
+	mixer.pool.nthreads = 1;
 
 	fprintf(stderr,
 		"%s "PATCHMATRIX_VERSION"\n"
@@ -382,7 +1934,7 @@ main(int argc, char **argv)
 		"Released under Artistic License 2.0 by Open Music Kontrollers\n", argv[0]);
 
 	int c;
-	while((c = getopt(argc, argv, "vht:i:o:n:")) != -1)
+	while((c = getopt(argc, argv, "vht:i:o:n:r:f:c:j:z")) != -1)
 	{
 		switch(c)
 		{
@@ -411,11 +1963,16 @@ main(int argc, char **argv)
 					"OPTIONS\n"
 					"   [-v]                 print version and full license information\n"
 					"   [-h]                 print usage information\n"
-					"   [-t] port-type       port type (audio, midi)\n"
+					"   [-t] port-type       port type (audio, midi, cv, osc)\n"
 					"   [-i] input-num       port input number (1-%i)\n"
 					"   [-o] output-num      port output number (1-%i)\n"
-					"   [-n] server-name     connect to named JACK daemon\n\n"
-					, argv[0], PORT_MAX, PORT_MAX);
+					"   [-n] server-name     connect to named JACK daemon\n"
+					"   [-r] ramp-time       gain ramp time in ms (0-1000)\n"
+					"   [-j] thread-num      audio/CV mixing threads (1-%i)\n"
+					"   [-f] filter          OSC connection filter (source,sink,pattern)\n"
+					"   [-c] controller      14-bit MIDI CC mapping (channel,controller,source,sink)\n"
+					"   [-z]                 serve spawn requests with pre-forked mixers\n\n"
+					, argv[0], PORT_MAX, PORT_MAX, MIXER_THREAD_MAX);
 				return 0;
 			case 'n':
 				server_name = optarg;
@@ -425,17 +1982,90 @@ main(int argc, char **argv)
 				break;
 			case 'i':
 				nsinks = atoi(optarg);
-				if(nsinks > PORT_MAX)
+				if(nsinks < 1)
+					nsinks = 1;
+				else if(nsinks > PORT_MAX)
 					nsinks = PORT_MAX;
 				break;
 			case 'o':
 				nsources = atoi(optarg);
-				if(nsources > PORT_MAX)
+				if(nsources < 1)
+					nsources = 1;
+				else if(nsources > PORT_MAX)
 					nsources = PORT_MAX;
 				break;
+			case 'r':
+				ramp_ms = atoi(optarg);
+				if(ramp_ms > 1000)
+					ramp_ms = 1000;
+				break;
+			case 'j':
+				mixer.pool.nthreads = atoi(optarg);
+				if(mixer.pool.nthreads < 1)
+					mixer.pool.nthreads = 1;
+				else if(mixer.pool.nthreads > MIXER_THREAD_MAX)
+					mixer.pool.nthreads = MIXER_THREAD_MAX;
+				break;
+			case 'f':
+			{
+				unsigned source = 0;
+				unsigned sink = 0;
+				int len = 0;
+
+				mixer_filter_t *filters = realloc(mixer.filters,
+					(mixer.nfilters + 1) * sizeof(mixer_filter_t));
+				if(!filters)
+				{
+					_mixer_dealloc(&mixer);
+					return -1;
+				}
+				mixer.filters = filters;
+
+				// compile outside of RT thread, once and for all
+				mixer_filter_t *filter = &mixer.filters[mixer.nfilters];
+				if(  (sscanf(optarg, "%u,%u,%n", &source, &sink, &len) != 2) || !len
+					|| (source < 1) || (sink < 1)
+					|| !_osc_pattern_compile(&filter->pattern, &optarg[len]) )
+				{
+					fprintf(stderr, "Invalid filter `%s'.\n", optarg);
+					_mixer_dealloc(&mixer);
+					return -1;
+				}
+
+				filter->source = source - 1;
+				filter->sink = sink - 1;
+				mixer.nfilters += 1;
+			} break;
+			case 'c':
+			{
+				unsigned chn = 0;
+				unsigned ctr = 0;
+				unsigned source = 0;
+				unsigned sink = 0;
+
+				// controller 6 is NRPN data entry, its LSB 38 is taken, too
+				if(  (sscanf(optarg, "%u,%u,%u,%u", &chn, &ctr, &source, &sink) != 4)
+					|| (chn < 1) || (chn > 0x10) || (ctr >= 0x20) || (ctr == 0x06)
+					|| (source < 1) || (sink < 1) )
+				{
+					fprintf(stderr, "Invalid controller mapping `%s'.\n", optarg);
+					_mixer_dealloc(&mixer);
+					return -1;
+				}
+
+				mixer_cc_t *cc = &mixer.cc[chn - 1][ctr];
+				cc->mapped = true;
+				cc->source = source - 1;
+				cc->sink = sink - 1;
+			} break;
+			case 'z':
+				zygote = true;
+				break;
 			case '?':
 				if( (optopt == 'n') || (optopt == 'u') || (optopt == 't')
-						|| (optopt == 'i') || (optopt == 'o') || (optopt == 'd') )
+						|| (optopt == 'i') || (optopt == 'o') || (optopt == 'd')
+						|| (optopt == 'r') || (optopt == 'f') || (optopt == 'c')
+						|| (optopt == 'j') )
 					fprintf(stderr, "Option `-%c' requires an argument.\n", optopt);
 				else if(isprint(optopt))
 					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -447,168 +2077,50 @@ main(int argc, char **argv)
 		}
 	}
 
-	jack_options_t opts = JackNullOption | JackNoStartServer;
-	if(server_name)
-		opts |= JackServerName;
-
-	jack_status_t status;
-	mixer.client = jack_client_open(PATCHMATRIX_MIXER_ID, opts, &status,
-		server_name ? server_name : NULL);
-	if(!mixer.client)
-		return -1;
-
-	unsigned i;
-	for(i = 0; i < nsinks; i++)
+	if(zygote)
 	{
-		char buf [32];
-		snprintf(buf, 32, "sink_%02u", i + 1);
-
-		jack_port_t *jsink = jack_port_register(mixer.client, buf,
-			mixer.type == TYPE_AUDIO ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE,
-			JackPortIsInput, 0);
-
-#ifdef JACK_HAS_METADATA_API
-		jack_uuid_t uuid = jack_port_uuid(jsink);
-
-		snprintf(buf, 32, "%u", i);
-		jack_set_property(mixer.client, uuid, JACKEY_ORDER, buf, XSD__integer);
-
-		if(mixer.type == TYPE_MIDI)
-			jack_set_property(mixer.client, uuid, JACKEY_EVENT_TYPES, "MIDI", "text/plain");
-
-		snprintf(buf, 32, "Sink %u", i + 1);
-		jack_set_property(mixer.client, uuid, JACK_METADATA_PRETTY_NAME, buf, "text/plain");
-#endif
-
-		mixer.jsinks[i] = jsink;
+		// only returns 0 in a warm mixer that has taken a spawn request
+		const int ret = _zygote_run(&mixer, server_name, &nsinks, &nsources);
+		if(ret != 0)
+		{
+			_mixer_dealloc(&mixer);
+			return (ret == 1) ? 0 : -1;
+		}
 	}
-
+	else if(!(mixer.client = _mixer_client_open(server_name)))
 	{
-		char buf [32];
-		snprintf(buf, 32, "automation");
-
-		jack_port_t *jautom = jack_port_register(mixer.client, buf,
-			JACK_DEFAULT_MIDI_TYPE,
-			JackPortIsInput, 0);
-
-#ifdef JACK_HAS_METADATA_API
-		jack_uuid_t uuid = jack_port_uuid(jautom);
-
-		snprintf(buf, 32, "%u", i);
-		jack_set_property(mixer.client, uuid, JACKEY_ORDER, buf, XSD__integer);
-
-		jack_set_property(mixer.client, uuid, JACKEY_EVENT_TYPES, "MIDI,OSC", "text/plain");
-
-		jack_set_property(mixer.client, uuid, JACK_METADATA_PRETTY_NAME, "Automation", "text/plain");
-#endif
-
-		mixer.jautom = jautom;
+		_mixer_dealloc(&mixer);
+		return -1;
 	}
 
-	for(unsigned j = 0; j < nsources; j++)
-	{
-		char buf [32];
-		snprintf(buf, 32, "source_%02u", j + 1);
-
-		jack_port_t *jsource = jack_port_register(mixer.client, buf,
-			mixer.type == TYPE_AUDIO ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE,
-			JackPortIsOutput, 0);
-
-#ifdef JACK_HAS_METADATA_API
-		jack_uuid_t uuid = jack_port_uuid(jsource);
-
-		snprintf(buf, 32, "%u", j);
-		jack_set_property(mixer.client, uuid, JACKEY_ORDER, buf, XSD__integer);
-
-		if(mixer.type == TYPE_MIDI)
-			jack_set_property(mixer.client, uuid, JACKEY_EVENT_TYPES, "MIDI", "text/plain");
-
-		snprintf(buf, 32, "Source %u", j + 1);
-		jack_set_property(mixer.client, uuid, JACK_METADATA_PRETTY_NAME, buf, "text/plain");
-#endif
-
-		mixer.jsources[j] = jsource;
-	}
+	const bool has_pool = !_mixer_events(&mixer) && (mixer.pool.nthreads > 1);
 
-	const char *client_name = jack_get_client_name(mixer.client);
-	const int fd = shm_open(client_name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
-	if(fd != -1)
+	if(_mixer_init(&mixer, jack_get_client_name(mixer.client), "",
+		nsinks, nsources, ramp_ms) == 0)
 	{
-		if(ftruncate(fd, total_size) != -1)
-		{
-			if((mixer.shm = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
-				MAP_SHARED, fd, 0)) != MAP_FAILED)
-			{
-				mixer.shm->nsinks = nsinks;
-				mixer.shm->nsources = nsources;
-
-				atomic_init(&mixer.shm->closing, false);
-
-				for(unsigned j = 0; j < nsources; j++)
-				{
-					for(unsigned i = 0; i < nsinks; i++)
-					{
-						if(j == i)
-							atomic_init(&mixer.shm->jgains[j][i], 0);
-						else
-							atomic_init(&mixer.shm->jgains[j][i], -3600);
-					}
-				}
-
-				if(sem_init(&mixer.shm->done, 1, 0) != -1)
-				{
-					jack_on_info_shutdown(mixer.client, _jack_on_info_shutdown_cb, &mixer);
-					jack_set_process_callback(mixer.client,
-						mixer.type == TYPE_AUDIO ? _audio_mixer_process : _midi_mixer_process,
-						&mixer);
-					//TODO CV
-
-					jack_activate(mixer.client);
+		jack_on_info_shutdown(mixer.client, _jack_on_info_shutdown_cb, &mixer);
+		jack_set_process_callback(mixer.client, _mixer_process_callback(&mixer), &mixer);
 
-					sem_wait(&mixer.shm->done);
-					atomic_store_explicit(&mixer.shm->closing, true, memory_order_relaxed);
+		if(has_pool)
+			_mixer_pool_start(&mixer);
 
-					jack_deactivate(mixer.client);
-
-					sem_destroy(&mixer.shm->done);
-				}
-
-				atomic_store_explicit(&closed, true, memory_order_relaxed);
-				munmap(mixer.shm, total_size);
-			}
-		}
+		jack_activate(mixer.client);
 
-		close(fd);
-		shm_unlink(client_name);
-	}
+		sem_wait(&mixer.shm->done);
+		atomic_store_explicit(&mixer.shm->closing, true, memory_order_relaxed);
 
-	for(unsigned i = 0; i < nsinks; i++)
-	{
-#ifdef JACK_HAS_METADATA_API
-		jack_uuid_t uuid = jack_port_uuid(mixer.jsinks[i]);
-		jack_remove_properties(mixer.client, uuid);
-#endif
-		jack_port_unregister(mixer.client, mixer.jsinks[i]);
-	}
+		jack_deactivate(mixer.client);
 
-	{
-#ifdef JACK_HAS_METADATA_API
-		jack_uuid_t uuid = jack_port_uuid(mixer.jautom);
-		jack_remove_properties(mixer.client, uuid);
-#endif
-		jack_port_unregister(mixer.client, mixer.jautom);
+		if(has_pool)
+			_mixer_pool_stop(&mixer);
 	}
 
-	for(unsigned j = 0; j < nsources; j++)
-	{
-#ifdef JACK_HAS_METADATA_API
-		jack_uuid_t uuid = jack_port_uuid(mixer.jsources[j]);
-		jack_remove_properties(mixer.client, uuid);
-#endif
-		jack_port_unregister(mixer.client, mixer.jsources[j]);
-	}
+	atomic_store_explicit(&closed, true, memory_order_relaxed);
 
+	_mixer_deinit(&mixer);
 	jack_client_close(mixer.client);
+	_mixer_dealloc(&mixer);
 
 	return 0;
 }
+#endif
@@ -8,26 +8,92 @@
 #include <fcntl.h>
 
 #include <patchmatrix/patchmatrix.h>
+#include <patchmatrix/patchmatrix_gain.h>
+#include <patchmatrix/patchmatrix_dsp.h>
 
+#ifdef PATCHMATRIX_UNIT
+#	include <patchmatrix/patchmatrix_engine.h>
+#endif
+
+#define LUFS_MOMENTARY 4 // 100 ms sub-blocks per momentary window
+#define LUFS_BLOCKS 30 // 100 ms sub-blocks per short-term window
+#define LUFS_FLOOR -70.f // LUFS, absolute gate
+#define LUFS_BINS 750 // 0.1 LU histogram bins from LUFS_FLOOR up to +5 LUFS
+
+typedef struct _monitor_meter_t monitor_meter_t;
+typedef struct _monitor_biquad_t monitor_biquad_t;
+typedef struct _monitor_loudness_t monitor_loudness_t;
+typedef struct _monitor_cv_t monitor_cv_t;
 typedef struct _monitor_app_t monitor_app_t;
 
+struct _monitor_meter_t {
+	float peak; // dBFS, with ballistics
+	float rms; // dBFS, with ballistics
+	float true_peak; // dBFS, with ballistics
+	float hold; // dBFS
+	uint32_t held; // frames since hold was last set
+	dsp_meter_t dsp; // integrated linear levels
+};
+
+struct _monitor_biquad_t {
+	double b0, b1, b2;
+	double a1, a2;
+};
+
+struct _monitor_loudness_t {
+	double z [2][2]; // K-weighting filter states
+	double sum; // sum of squares of current sub-block
+	uint32_t frames; // frames in current sub-block
+	double blocks [LUFS_BLOCKS]; // mean squares of most recent sub-blocks
+	unsigned idx; // next sub-block to overwrite
+	unsigned nblocks; // valid sub-blocks
+	double gated_sum; // mean squares of momentary blocks above absolute gate
+	uint64_t gated_count;
+	uint32_t hist [LUFS_BINS]; // momentary blocks above absolute gate
+	float momentary; // LUFS
+	float short_term; // LUFS
+	float integrated; // LUFS
+};
+
+struct _monitor_cv_t {
+	float min;
+	float max;
+	double sum;
+	uint32_t frames; // accumulated since last publication
+};
+
 struct _monitor_app_t {
 	jack_client_t *client;
-	jack_port_t *jsinks [PORT_MAX];
+	char *name; // of shm, prefix of ports when hosted by engine
+	unsigned nsinks;
+	jack_port_t **jsinks;
 	float sample_rate_1;
+	dsp_t dsp;
+	monitor_mode_t mode;
+	float attack; // integrator coefficient per metered sub-block, one for instant
+	float release; // dB/s
+	uint32_t hold_frames; // zero to hold forever
+	uint32_t block_frames; // frames per 100 ms loudness sub-block or CV window
+	monitor_biquad_t kweight [2]; // high-shelf, high-pass
 	union {
 		struct {
-			float dBFSs [PORT_MAX];
+			monitor_meter_t *meters;
+			monitor_loudness_t *loudness; // LUFS mode only
 		} audio;
 		struct {
-			float vels [PORT_MAX];
+			float *vels;
 		} midi;
+		struct {
+			monitor_cv_t *cvs;
+		} cv;
 	};
 	port_type_t type;
 
 	monitor_shm_t *shm;	
 };
 
+static double lufs_energy [LUFS_BINS]; // mean square at histogram bin centers
+
 static atomic_bool closed = ATOMIC_VAR_INIT(false);
 
 static void
@@ -46,6 +112,166 @@ _jack_on_info_shutdown_cb(jack_status_t code, const char *reason, void *arg)
 	_close(shm);
 }
 
+static inline bool
+_monitor_level_store(atomic_int *level, int32_t mval)
+{
+	if(atomic_load_explicit(level, memory_order_relaxed) != mval)
+	{
+		atomic_store_explicit(level, mval, memory_order_relaxed);
+		return true;
+	}
+
+	return false;
+}
+
+// integrator starts from the released level
+static inline void
+_monitor_level_release(float *dBFS, float *env, float decay)
+{
+	if(*dBFS > -64.f)
+		*dBFS -= decay;
+
+	*env = (*dBFS > -64.f) ? exp10f(*dBFS / 20.f) : 0.f;
+}
+
+static inline bool
+_monitor_level_update(atomic_int *level, float *dBFS, float env)
+{
+	const float dBFS_env = (env > 0.f)
+		? 6.f + _gain_to_dBFS(env / 2.f) // dBFS+6
+		: -64.f;
+
+	if(dBFS_env > *dBFS)
+		*dBFS = dBFS_env;
+
+	return _monitor_level_store(level, rintf(*dBFS * 100.f));
+}
+
+static inline bool
+_monitor_hold_update(monitor_app_t *monitor, monitor_meter_t *meter,
+	atomic_int *level, jack_nframes_t nframes)
+{
+	if(monitor->hold_frames)
+	{
+		meter->held += nframes;
+
+		if(meter->held >= monitor->hold_frames) // drop to current level
+			meter->hold = -64.f;
+	}
+
+	if(meter->true_peak >= meter->hold)
+	{
+		meter->hold = meter->true_peak;
+		meter->held = 0;
+	}
+
+	return _monitor_level_store(level, rintf(meter->hold * 100.f));
+}
+
+static inline float
+_lufs(double z)
+{
+	if(z <= 0.0)
+		return LUFS_FLOOR;
+
+	const float L = -0.691f + 0.5f*_gain_to_dBFS(z); // 10*log10(z)
+
+	return (L > LUFS_FLOOR) ? L : LUFS_FLOOR;
+}
+
+static void
+_monitor_loudness_block(monitor_loudness_t *loud)
+{
+	loud->blocks[loud->idx] = loud->sum / loud->frames;
+	loud->idx = (loud->idx + 1) % LUFS_BLOCKS;
+	if(loud->nblocks < LUFS_BLOCKS)
+		loud->nblocks += 1;
+
+	loud->sum = 0.0;
+	loud->frames = 0;
+
+	// windows are padded with silence until filled
+	double momentary = 0.0;
+	double short_term = 0.0;
+	for(unsigned b = 0; b < loud->nblocks; b++)
+	{
+		const double z = loud->blocks[(loud->idx + LUFS_BLOCKS - 1 - b) % LUFS_BLOCKS];
+
+		if(b < LUFS_MOMENTARY)
+			momentary += z;
+		short_term += z;
+	}
+	momentary /= LUFS_MOMENTARY;
+	short_term /= LUFS_BLOCKS;
+
+	loud->momentary = _lufs(momentary);
+	loud->short_term = _lufs(short_term);
+
+	// gating blocks of 400 ms overlap by 75%, thus one per sub-block
+	if( (loud->nblocks < LUFS_MOMENTARY) || (loud->momentary <= LUFS_FLOOR) )
+		return;
+
+	unsigned bin = (loud->momentary - LUFS_FLOOR) * 10.f;
+	if(bin >= LUFS_BINS)
+		bin = LUFS_BINS - 1;
+
+	loud->gated_sum += momentary;
+	loud->gated_count += 1;
+	loud->hist[bin] += 1;
+
+	// relative gate 10 LU below absolutely gated loudness
+	const float gate = _lufs(loud->gated_sum / loud->gated_count) - 10.f;
+	const unsigned first = (gate > LUFS_FLOOR)
+		? ceilf((gate - LUFS_FLOOR) * 10.f)
+		: 0;
+
+	double sum = 0.0;
+	uint64_t count = 0;
+	for(unsigned b = first; b < LUFS_BINS; b++)
+	{
+		sum += loud->hist[b] * lufs_energy[b];
+		count += loud->hist[b];
+	}
+
+	loud->integrated = count
+		? _lufs(sum / count)
+		: LUFS_FLOOR;
+}
+
+static bool
+_monitor_loudness_update(monitor_app_t *monitor, monitor_loudness_t *loud,
+	const float *psink, jack_nframes_t nframes)
+{
+	bool updated = false;
+
+	for(unsigned k = 0; k < nframes; k++)
+	{
+		double x = psink[k];
+
+		// K-weighting, transposed direct form II
+		for(unsigned s = 0; s < 2; s++)
+		{
+			const monitor_biquad_t *bq = &monitor->kweight[s];
+			double *z = loud->z[s];
+
+			const double y = bq->b0*x + z[0];
+			z[0] = bq->b1*x - bq->a1*y + z[1];
+			z[1] = bq->b2*x - bq->a2*y;
+			x = y;
+		}
+
+		loud->sum += x*x;
+
+		if(++loud->frames == monitor->block_frames)
+		{
+			_monitor_loudness_block(loud);
+			updated = true;
+		}
+	}
+
+	return updated;
+}
+
 static int
 _audio_monitor_process(jack_nframes_t nframes, void *arg)
 {
@@ -58,38 +284,46 @@ _audio_monitor_process(jack_nframes_t nframes, void *arg)
 		return 0;
 	}
 
-	const float *psinks [PORT_MAX];
-
 	const unsigned nsinks = shm->nsinks;
+	const float decay = nframes * monitor->release * monitor->sample_rate_1;
+	bool changed = false;
 
 	for(unsigned i = 0; i < nsinks; i++)
 	{
 		jack_port_t *jsink = monitor->jsinks[i];
-		psinks[i] = jack_port_get_buffer(jsink, nframes);
+		const float *psink = jack_port_get_buffer(jsink, nframes);
+		monitor_meter_t *meter = &monitor->audio.meters[i];
+		monitor_level_t *level = &shm->levels[i];
 
-		float peak = 0.f;
-		for(unsigned k = 0; k < nframes; k++)
-		{
-			const float sample = fabsf(psinks[i][k]);
-			if(sample > peak)
-				peak = sample;
-		}
+		_monitor_level_release(&meter->peak, &meter->dsp.peak, decay);
+		_monitor_level_release(&meter->rms, &meter->dsp.rms, decay);
+		_monitor_level_release(&meter->true_peak, &meter->dsp.true_peak, decay);
 
-		// go to zero in 1/2 s
-		if(monitor->audio.dBFSs[i] > -64.f)
-			monitor->audio.dBFSs[i] -= nframes * 70.f * 2.f * monitor->sample_rate_1;
+		// peak, RMS and true-peak integrated in the linear domain in a single pass
+		_dsp_meter(&monitor->dsp, psink, nframes, &meter->dsp, monitor->attack);
 
-		const float dBFS = (peak > 0.f)
-			? 6.f + 20.f*log10f(peak / 2.f) // dBFS+6
-			: -64.f;
+		changed |= _monitor_level_update(&level->peak, &meter->peak, meter->dsp.peak);
+		changed |= _monitor_level_update(&level->rms, &meter->rms, meter->dsp.rms);
+		changed |= _monitor_level_update(&level->true_peak, &meter->true_peak,
+			meter->dsp.true_peak);
+		changed |= _monitor_hold_update(monitor, meter, &level->hold, nframes);
 
-		if(dBFS > monitor->audio.dBFSs[i])
-			monitor->audio.dBFSs[i] = dBFS;
+		if(monitor->audio.loudness)
+		{
+			monitor_loudness_t *loud = &monitor->audio.loudness[i];
 
-		const int32_t mBFS = rintf(monitor->audio.dBFSs[i] * 100.f);
-		atomic_store_explicit(&shm->jgains[i], mBFS, memory_order_relaxed);
+			if(_monitor_loudness_update(monitor, loud, psink, nframes))
+			{
+				changed |= _monitor_level_store(&level->momentary, rintf(loud->momentary * 100.f));
+				changed |= _monitor_level_store(&level->short_term, rintf(loud->short_term * 100.f));
+				changed |= _monitor_level_store(&level->integrated, rintf(loud->integrated * 100.f));
+			}
+		}
 	}
 
+	if(changed) // tell UI to redraw
+		atomic_fetch_add_explicit(&shm->seq, 1, memory_order_release);
+
 	return 0;
 }
 
@@ -105,21 +339,20 @@ _midi_monitor_process(jack_nframes_t nframes, void *arg)
 		return 0;
 	}
 
-	void *psinks [PORT_MAX];
-
 	const unsigned nsinks = shm->nsinks;
+	bool changed = false;
 
 	for(unsigned i = 0; i < nsinks; i++)
 	{
 		jack_port_t *jsink = monitor->jsinks[i];
-		psinks[i] = jack_port_get_buffer(jsink, nframes);
+		void *psink = jack_port_get_buffer(jsink, nframes);
 
 		float vel = 0.f;
-		const uint32_t count = jack_midi_get_event_count(psinks[i]);
+		const uint32_t count = jack_midi_get_event_count(psink);
 		for(unsigned k = 0; k < count; k++)
 		{
 			jack_midi_event_t ev;
-			jack_midi_event_get(&ev, psinks[i], k);
+			jack_midi_event_get(&ev, psink, k);
 
 			if(ev.size != 3)
 				continue;
@@ -139,21 +372,414 @@ _midi_monitor_process(jack_nframes_t nframes, void *arg)
 			monitor->midi.vels[i] = vel;
 
 		const int32_t cvel = rintf(monitor->midi.vels[i] * 100.f);
-		atomic_store_explicit(&shm->jgains[i], cvel, memory_order_relaxed);
+		if(atomic_load_explicit(&shm->levels[i].peak, memory_order_relaxed) != cvel)
+		{
+			atomic_store_explicit(&shm->levels[i].peak, cvel, memory_order_relaxed);
+			changed = true;
+		}
+	}
+
+	if(changed) // tell UI to redraw
+		atomic_fetch_add_explicit(&shm->seq, 1, memory_order_release);
+
+	return 0;
+}
+
+#ifdef JACK_HAS_METADATA_API
+static inline void
+_monitor_cv_reset(monitor_cv_t *cv)
+{
+	cv->min = HUGE_VALF;
+	cv->max = -HUGE_VALF;
+	cv->sum = 0.0;
+	cv->frames = 0;
+}
+
+static inline int32_t
+_monitor_cv_milli(float value)
+{
+	const float mval = value * GAIN_UNITY_CV;
+
+	return rintf(fmaxf(-1e6f, fminf(mval, 1e6f))); // limit to +-1000
+}
+
+static int
+_cv_monitor_process(jack_nframes_t nframes, void *arg)
+{
+	monitor_app_t *monitor = arg;
+	monitor_shm_t *shm = monitor->shm;
+
+	if(  atomic_load_explicit(&closed, memory_order_relaxed)
+		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
+	{
+		return 0;
+	}
+
+	const unsigned nsinks = shm->nsinks;
+	bool changed = false;
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		jack_port_t *jsink = monitor->jsinks[i];
+		const float *psink = jack_port_get_buffer(jsink, nframes);
+		monitor_cv_t *cv = &monitor->cv.cvs[i];
+		monitor_level_t *level = &shm->levels[i];
+
+		// no ballistics, values are exact over each window
+		float min = cv->min;
+		float max = cv->max;
+		double sum = 0.0;
+		for(unsigned k = 0; k < nframes; k++)
+		{
+			const float x = psink[k];
+
+			min = fminf(min, x);
+			max = fmaxf(max, x);
+			sum += x;
+		}
+
+		cv->min = min;
+		cv->max = max;
+		cv->sum += sum;
+		cv->frames += nframes;
+
+		if(cv->frames < monitor->block_frames)
+			continue;
+
+		changed |= _monitor_level_store(&level->min, _monitor_cv_milli(cv->min));
+		changed |= _monitor_level_store(&level->max, _monitor_cv_milli(cv->max));
+		changed |= _monitor_level_store(&level->mean, _monitor_cv_milli(cv->sum / cv->frames));
+
+		_monitor_cv_reset(cv);
+	}
+
+	if(changed) // tell UI to redraw
+		atomic_fetch_add_explicit(&shm->seq, 1, memory_order_release);
+
+	return 0;
+}
+#endif
+
+static void
+_monitor_ballistics_init(monitor_app_t *monitor, double sample_rate)
+{
+	switch(monitor->mode)
+	{
+		case MONITOR_MODE_PPM:
+		{
+			monitor->attack = _dsp_meter_attack(0.005f, sample_rate); // 10 ms bursts read ~-1 dB
+			monitor->release = 20.f / 1.7f; // 20 dB in 1.7 s
+			monitor->hold_frames = 2 * sample_rate;
+		} break;
+		case MONITOR_MODE_LUFS:
+		{
+			monitor->attack = 1.f;
+			monitor->release = 70.f * 2.f; // go to zero in 1/2 s
+			monitor->hold_frames = 0; // maximum true-peak since start
+		} break;
+		case MONITOR_MODE_PEAK:
+		default:
+		{
+			monitor->attack = 1.f;
+			monitor->release = 70.f * 2.f; // go to zero in 1/2 s
+			monitor->hold_frames = 2 * sample_rate;
+		} break;
+	}
+
+	monitor->block_frames = sample_rate / 10;
+
+	// K-weighting after ITU-R BS.1770-4, derived for arbitrary sample rates
+	{
+		const double f0 = 1681.974450955533;
+		const double G = 3.999843853973347;
+		const double Q = 0.7071752369554196;
+		const double K = tan(M_PI * f0 / sample_rate);
+		const double Vh = pow(10.0, G / 20.0);
+		const double Vb = pow(Vh, 0.4996667741545416);
+		const double a0 = 1.0 + K / Q + K*K;
+
+		monitor->kweight[0] = (monitor_biquad_t){
+			.b0 = (Vh + Vb * K / Q + K*K) / a0,
+			.b1 = 2.0 * (K*K - Vh) / a0,
+			.b2 = (Vh - Vb * K / Q + K*K) / a0,
+			.a1 = 2.0 * (K*K - 1.0) / a0,
+			.a2 = (1.0 - K / Q + K*K) / a0
+		};
+	}
+	{
+		const double f0 = 38.13547087602444;
+		const double Q = 0.5003270373238773;
+		const double K = tan(M_PI * f0 / sample_rate);
+		const double a0 = 1.0 + K / Q + K*K;
+
+		monitor->kweight[1] = (monitor_biquad_t){
+			.b0 = 1.0,
+			.b1 = -2.0,
+			.b2 = 1.0,
+			.a1 = 2.0 * (K*K - 1.0) / a0,
+			.a2 = (1.0 - K / Q + K*K) / a0
+		};
+	}
+
+	for(unsigned b = 0; b < LUFS_BINS; b++)
+	{
+		const double L = LUFS_FLOOR + (b + 0.5) / 10.0; // bin center
+
+		lufs_energy[b] = pow(10.0, (L + 0.691) / 10.0);
+	}
+}
+
+static void
+_monitor_dealloc(monitor_app_t *monitor)
+{
+	free(monitor->jsinks);
+	free(monitor->audio.meters); // aliases midi.vels and cv.cvs
+	free(monitor->audio.loudness);
+	free(monitor->name);
+}
+
+// map shm of given name and register ports, prefixed when hosted by engine
+static int
+_monitor_init(monitor_app_t *monitor, const char *name, const char *prefix,
+	unsigned nsinks)
+{
+	const size_t total_size = _monitor_shm_size(nsinks);
+
+	monitor->nsinks = nsinks;
+	monitor->name = strdup(name);
+	monitor->jsinks = calloc(nsinks, sizeof(jack_port_t *));
+	if(monitor->type == TYPE_MIDI)
+	{
+		monitor->mode = MONITOR_MODE_PEAK; // ballistics are audio only
+		monitor->midi.vels = calloc(nsinks, sizeof(float));
+	}
+#ifdef JACK_HAS_METADATA_API
+	else if(monitor->type == TYPE_CV)
+	{
+		monitor->mode = MONITOR_MODE_PEAK; // ballistics are audio only
+		monitor->cv.cvs = calloc(nsinks, sizeof(monitor_cv_t));
+	}
+#endif
+	else
+	{
+		monitor->audio.meters = calloc(nsinks, sizeof(monitor_meter_t));
+		if(monitor->mode == MONITOR_MODE_LUFS)
+		{
+			monitor->audio.loudness = calloc(nsinks, sizeof(monitor_loudness_t));
+			if(!monitor->audio.loudness)
+				return -1;
+		}
+	}
+	if(!monitor->name || !monitor->jsinks || !monitor->audio.meters)
+		return -1;
+
+	const jack_nframes_t sample_rate = jack_get_sample_rate(monitor->client);
+	monitor->sample_rate_1 = 1.f / sample_rate;
+	_dsp_init(&monitor->dsp);
+	_monitor_ballistics_init(monitor, sample_rate);
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		if(monitor->type == TYPE_AUDIO)
+		{
+			monitor_meter_t *meter = &monitor->audio.meters[i];
+
+			meter->peak = -64.f;
+			meter->rms = -64.f;
+			meter->true_peak = -64.f;
+			meter->hold = -64.f;
+		}
+		else if(monitor->type == TYPE_MIDI)
+			monitor->midi.vels[i] = 0.f;
+#ifdef JACK_HAS_METADATA_API
+		else if(monitor->type == TYPE_CV)
+			_monitor_cv_reset(&monitor->cv.cvs[i]);
+#endif
+	}
+
+	const int fd = shm_open(name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if(fd == -1)
+		return -1;
+
+	if(ftruncate(fd, total_size) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+
+	monitor_shm_t *shm = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(shm == MAP_FAILED)
+		return -1;
+
+	if(sem_init(&shm->done, 1, 0) == -1)
+	{
+		munmap(shm, total_size);
+		return -1;
+	}
+
+	monitor->shm = shm;
+
+	shm->hdr.size = total_size;
+	shm->nsinks = nsinks;
+	shm->mode = monitor->mode;
+
+	atomic_init(&shm->closing, false);
+	atomic_init(&shm->seq, 0);
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		monitor_level_t *level = &shm->levels[i];
+
+		atomic_init(&level->peak, 0);
+		atomic_init(&level->rms, 0);
+		atomic_init(&level->true_peak, 0);
+		atomic_init(&level->hold, -6400);
+		atomic_init(&level->momentary, LUFS_FLOOR * 100);
+		atomic_init(&level->short_term, LUFS_FLOOR * 100);
+		atomic_init(&level->integrated, LUFS_FLOOR * 100);
+		atomic_init(&level->min, 0);
+		atomic_init(&level->max, 0);
+		atomic_init(&level->mean, 0);
+	}
+
+	// layout is complete, let UI map it as soon as ports show up
+	atomic_store_explicit(&shm->hdr.version, SHM_VERSION, memory_order_release);
+
+#ifdef JACK_HAS_METADATA_API
+	const bool is_audio = (monitor->type == TYPE_AUDIO) || (monitor->type == TYPE_CV);
+#else
+	const bool is_audio = (monitor->type == TYPE_AUDIO);
+#endif
+	char port_name [128];
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		snprintf(port_name, sizeof(port_name), "%ssink_%02u", prefix, i + 1);
+
+		jack_port_t *jsink = jack_port_register(monitor->client, port_name,
+			is_audio ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE,
+			JackPortIsInput | JackPortIsTerminal, 0);
+		if(!jsink)
+			return -1;
+
+#ifdef JACK_HAS_METADATA_API
+		jack_uuid_t uuid = jack_port_uuid(jsink);
+		char buf [32];
+
+		snprintf(buf, 32, "%u", i);
+		jack_set_property(monitor->client, uuid, JACKEY_ORDER, buf, XSD__integer);
+
+		if(monitor->type == TYPE_CV)
+			jack_set_property(monitor->client, uuid, JACKEY_SIGNAL_TYPE, "CV", "text/plain");
+
+		snprintf(buf, 32, "Sink %u", i + 1);
+		jack_set_property(monitor->client, uuid, JACK_METADATA_PRETTY_NAME, buf, "text/plain");
+#endif
+
+		monitor->jsinks[i] = jsink;
 	}
 
 	return 0;
 }
 
+// undo whatever _monitor_init got done
+static void
+_monitor_deinit(monitor_app_t *monitor)
+{
+	for(unsigned i = 0; monitor->jsinks && (i < monitor->nsinks); i++)
+	{
+		jack_port_t *jsink = monitor->jsinks[i];
+
+		if(!jsink)
+			continue;
+
+#ifdef JACK_HAS_METADATA_API
+		jack_uuid_t uuid = jack_port_uuid(jsink);
+		jack_remove_properties(monitor->client, uuid);
+#endif
+		jack_port_unregister(monitor->client, jsink);
+	}
+
+	if(monitor->shm)
+	{
+		sem_destroy(&monitor->shm->done);
+		munmap(monitor->shm, monitor->shm->hdr.size);
+		monitor->shm = NULL;
+	}
+
+	if(monitor->name)
+		shm_unlink(monitor->name);
+}
+
+static JackProcessCallback
+_monitor_process_callback(monitor_app_t *monitor)
+{
+	switch(monitor->type)
+	{
+		case TYPE_AUDIO:
+			return _audio_monitor_process;
+#ifdef JACK_HAS_METADATA_API
+		case TYPE_CV:
+			return _cv_monitor_process;
+#endif
+		default:
+			return _midi_monitor_process;
+	}
+}
+
+#ifdef PATCHMATRIX_UNIT
+static void
+_monitor_unit_free(void *data)
+{
+	monitor_app_t *monitor = data;
+
+	_monitor_deinit(monitor);
+	_monitor_dealloc(monitor);
+	free(monitor);
+}
+
+bool
+_monitor_unit_new(unit_t *unit, jack_client_t *client, port_type_t type,
+	unsigned nsinks, monitor_mode_t mode)
+{
+	monitor_app_t *monitor = calloc(1, sizeof(monitor_app_t));
+	if(!monitor)
+		return false;
+
+	monitor->client = client;
+	monitor->type = type;
+	monitor->mode = mode;
+
+	char prefix [ENGINE_NAME_SIZE + 1];
+	snprintf(prefix, sizeof(prefix), "%s/", unit->name);
+
+	if(_monitor_init(monitor, unit->name, prefix, nsinks) != 0)
+	{
+		_monitor_unit_free(monitor);
+		return false;
+	}
+
+	unit->data = monitor;
+	unit->process = _monitor_process_callback(monitor);
+	unit->free = _monitor_unit_free;
+	unit->done = &monitor->shm->done;
+	unit->closing = &monitor->shm->closing;
+
+	return true;
+}
+#else
 int
 main(int argc, char **argv)
 {
 	static monitor_app_t monitor;
-	const size_t total_size = sizeof(monitor_shm_t);
 
 	const char *server_name = NULL;
 	unsigned nsinks = 1;
 	monitor.type = TYPE_AUDIO;
+	monitor.mode = MONITOR_MODE_PEAK;
 
 	fprintf(stderr,
 		"%s "PATCHMATRIX_VERSION"\n"
@@ -161,7 +787,7 @@ main(int argc, char **argv)
 		"Released under Artistic License 2.0 by Open Music Kontrollers\n", argv[0]);
 
 	int c;
-	while((c = getopt(argc, argv, "vht:i:n:")) != -1)
+	while((c = getopt(argc, argv, "vht:i:n:m:")) != -1)
 	{
 		switch(c)
 		{
@@ -190,8 +816,9 @@ main(int argc, char **argv)
 					"OPTIONS\n"
 					"   [-v]                 print version and full license information\n"
 					"   [-h]                 print usage information\n"
-					"   [-t] port-type       port type (audio, midi)\n"
+					"   [-t] port-type       port type (audio, midi, cv)\n"
 					"   [-i] input-num       port input number (1-%i)\n"
+					"   [-m] meter-mode      meter mode (peak, ppm, lufs)\n"
 					"   [-n] server-name     connect to named JACK daemon\n\n"
 					, argv[0], PORT_MAX);
 				return 0;
@@ -201,14 +828,19 @@ main(int argc, char **argv)
 			case 't':
 				monitor.type = _port_type_from_string(optarg);
 				break;
+			case 'm':
+				monitor.mode = _monitor_mode_from_string(optarg);
+				break;
 			case 'i':
 				nsinks = atoi(optarg);
-				if(nsinks > PORT_MAX)
+				if(nsinks < 1)
+					nsinks = 1;
+				else if(nsinks > PORT_MAX)
 					nsinks = PORT_MAX;
 				break;
 			case '?':
 				if( (optopt == 'n') || (optopt == 'u') || (optopt == 't')
-						|| (optopt == 'i') || (optopt == 'd') )
+						|| (optopt == 'i') || (optopt == 'd') || (optopt == 'm') )
 					fprintf(stderr, "Option `-%c' requires an argument.\n", optopt);
 				else if(isprint(optopt))
 					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -230,88 +862,25 @@ main(int argc, char **argv)
 	if(!monitor.client)
 		return -1;
 
-	monitor.sample_rate_1 = 1.f / jack_get_sample_rate(monitor.client);
-
-	for(unsigned i = 0; i < nsinks; i++)
-	{
-		char buf [32];
-		snprintf(buf, 32, "sink_%02u", i + 1);
-
-		jack_port_t *jsink = jack_port_register(monitor.client, buf,
-			monitor.type == TYPE_AUDIO ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE,
-			JackPortIsInput | JackPortIsTerminal, 0);
-
-#ifdef JACK_HAS_METADATA_API
-		jack_uuid_t uuid = jack_port_uuid(jsink);
-
-		snprintf(buf, 32, "%u", i);
-		jack_set_property(monitor.client, uuid, JACKEY_ORDER, buf, XSD__integer);
-
-		snprintf(buf, 32, "Sink %u", i + 1);
-		jack_set_property(monitor.client, uuid, JACK_METADATA_PRETTY_NAME, buf, "text/plain");
-#endif
-
-		if(monitor.type == TYPE_AUDIO)
-			monitor.audio.dBFSs[i] = -64.f;
-		else if(monitor.type == TYPE_MIDI)
-			monitor.midi.vels[i] = 0.f;
-
-		monitor.jsinks[i] = jsink;
-	}
-
-	const char *client_name = jack_get_client_name(monitor.client);
-	const int fd = shm_open(client_name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
-	if(fd != -1)
+	if(_monitor_init(&monitor, jack_get_client_name(monitor.client), "", nsinks) == 0)
 	{
-		if(ftruncate(fd, total_size) != -1)
-		{
-			if((monitor.shm = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
-				MAP_SHARED, fd, 0)) != MAP_FAILED)
-			{
-				monitor.shm->nsinks = nsinks;
-
-				atomic_init(&monitor.shm->closing, false);
-
-				for(unsigned i = 0; i < nsinks; i++)
-					atomic_init(&monitor.shm->jgains[i], 0);
-
-				if(sem_init(&monitor.shm->done, 1, 0) != -1)
-				{
-					jack_on_info_shutdown(monitor.client, _jack_on_info_shutdown_cb, &monitor);
-					jack_set_process_callback(monitor.client,
-						monitor.type == TYPE_AUDIO ? _audio_monitor_process : _midi_monitor_process,
-						&monitor);
-					//TODO CV
-
-					jack_activate(monitor.client);
-
-					sem_wait(&monitor.shm->done);
-					atomic_store_explicit(&monitor.shm->closing, true, memory_order_relaxed);
-
-					jack_deactivate(monitor.client);
+		jack_on_info_shutdown(monitor.client, _jack_on_info_shutdown_cb, &monitor);
+		jack_set_process_callback(monitor.client, _monitor_process_callback(&monitor), &monitor);
 
-					sem_destroy(&monitor.shm->done);
-				}
+		jack_activate(monitor.client);
 
-				atomic_store_explicit(&closed, true, memory_order_relaxed);
-				munmap(monitor.shm, total_size);
-			}
-		}
+		sem_wait(&monitor.shm->done);
+		atomic_store_explicit(&monitor.shm->closing, true, memory_order_relaxed);
 
-		close(fd);
-		shm_unlink(client_name);
+		jack_deactivate(monitor.client);
 	}
 
-	for(unsigned i = 0; i < nsinks; i++)
-	{
-#ifdef JACK_HAS_METADATA_API
-		jack_uuid_t uuid = jack_port_uuid(monitor.jsinks[i]);
-		jack_remove_properties(monitor.client, uuid);
-#endif
-		jack_port_unregister(monitor.client, monitor.jsinks[i]);
-	}
+	atomic_store_explicit(&closed, true, memory_order_relaxed);
 
+	_monitor_deinit(&monitor);
 	jack_client_close(monitor.client);
+	_monitor_dealloc(&monitor);
 
 	return 0;
 }
+#endif
@@ -10,6 +10,7 @@
 #include <patchmatrix/patchmatrix_jack.h>
 #include <patchmatrix/patchmatrix_db.h>
 #include <patchmatrix/patchmatrix_nk.h>
+#include <patchmatrix/patchmatrix_gain.h>
 
 const struct nk_color grid_line_color = {40, 40, 40, 255};
 const struct nk_color grid_background_color = {0, 0, 0, 255};
@@ -34,7 +35,11 @@ _client_moveable(struct nk_context *ctx, app_t *app, client_t *client,
 			client->moving = false;
 
 #ifdef JACK_HAS_METADATA_API
-			if(client->flags == (JackPortIsInput | JackPortIsOutput) )
+			if(jack_uuid_empty(client->uuid))
+			{
+				// hosted units keep their positions locally only
+			}
+			else if(client->flags == (JackPortIsInput | JackPortIsOutput) )
 			{
 				char val [32];
 
@@ -72,6 +77,7 @@ _client_moveable(struct nk_context *ctx, app_t *app, client_t *client,
 			client->pos.y += in->mouse.delta.y;
 			bounds->x += in->mouse.delta.x;
 			bounds->y += in->mouse.delta.y;
+			app->spatial.dirty = true;
 
 			// move connections together with client
 			HASH_FOREACH(&app->conns, client_conn_itr)
@@ -253,6 +259,25 @@ _client_connectors(struct nk_context *ctx, app_t *app, client_t *client,
 	}
 }
 
+static struct nk_vec2
+_client_dim(app_t *app, client_t *client)
+{
+	if(client->mixer_shm)
+	{
+		const float ps = 32.f * app->scale;
+
+		return nk_vec2(_mixer_shm_ncols(client->mixer_shm) * ps, client->mixer_shm->nsources * ps);
+	}
+	else if(client->monitor_shm)
+	{
+		const float ps = 24.f * app->scale;
+
+		return nk_vec2(6 * ps, client->monitor_shm->nsinks * ps);
+	}
+
+	return nk_vec2(200.f * app->scale, app->dy);
+}
+
 static void
 node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 {
@@ -269,11 +294,17 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 		return;
 
 	const float ps = 32.f * app->scale;
-	const unsigned nx = shm->nsinks;
+	const unsigned nx = _mixer_shm_ncols(shm); // plus offset column for CV
 	const unsigned ny = shm->nsources;
+#ifdef JACK_HAS_METADATA_API
+	const bool is_cv = (shm->type == TYPE_CV);
+	const bool is_osc = (shm->type == TYPE_OSC);
+#else
+	const bool is_cv = false;
+	const bool is_osc = false;
+#endif
 
-	client->dim.x = nx * ps;
-	client->dim.y = ny * ps;
+	client->dim = _client_dim(app, client);
 
 	struct nk_rect bounds = nk_rect(
 		client->pos.x - client->dim.x/2 - scrolling.x,
@@ -330,13 +361,19 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 				style->border, stroke_col);
 		}
 
+		// values read below are at least as recent as this
+		client->drawn.seq = atomic_load_explicit(&shm->seq, memory_order_acquire);
+		client->drawn.valid = true;
+
 		float x = body.x + ps/2;
 		for(unsigned i = 0; i < nx; i++)
 		{
+			const bool is_offset = (i == shm->nsinks);
+
 			float y = body.y + ps/2;
 			for(unsigned j = 0; j < ny; j++)
 			{
-				int32_t mBFS = atomic_load_explicit(&shm->jgains[j][i], memory_order_acquire);
+				int32_t mBFS = atomic_load_explicit(_mixer_shm_gain(shm, j, i), memory_order_acquire);
 
 				const struct nk_rect tile = nk_rect(x - ps/2, y - ps/2, ps, ps);
 
@@ -368,7 +405,7 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 					if(dd != 0)
 					{
 #if 0
-						if( (dd > 0) && (mBFS == -3600) ) // disabled
+						if( (dd > 0) && (mBFS == GAIN_MIN) ) // disabled
 						{
 							mBFS = 0; // jump to 0 dBFS
 						}
@@ -377,10 +414,10 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 						{
 							const bool has_shift = nk_input_is_key_down(in, NK_KEY_SHIFT);
 							const float mul = has_shift ? 10.f : 100.f;
-							mBFS = NK_CLAMP(-3600, mBFS + dd*mul, 3600);
+							mBFS = NK_CLAMP(GAIN_MIN, mBFS + dd*mul, GAIN_MAX);
 						}
 
-						atomic_store_explicit(&shm->jgains[j][i], mBFS, memory_order_release);
+						_mixer_gain_request(shm, j, i, mBFS);
 					}
 				}
 
@@ -395,7 +432,9 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 					const float fh = font->height;
 
 					{
-						const size_t tmp_len = snprintf(tmp, 32, "[%u-%u]", i+1, j+1); //FIXME use port names
+						const size_t tmp_len = is_offset
+							? snprintf(tmp, 32, "[offset-%u]", j+1)
+							: snprintf(tmp, 32, "[%u-%u]", i+1, j+1); //FIXME use port names
 						const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
 						const float fy = body.y + body.h + fh/2;
 						const struct nk_rect body2 = {
@@ -409,7 +448,15 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 					}
 
 					{
-						const size_t tmp_len = snprintf(tmp, 32, "%+2.2f dBFS", dBFS);
+						size_t tmp_len;
+						if(is_offset)
+							tmp_len = snprintf(tmp, 32, "%+1.3f", _gain_from_cv(mBFS));
+						else if(is_cv)
+							tmp_len = snprintf(tmp, 32, "x%+1.3f", _gain_from_cv(mBFS));
+						else if(is_osc) // packets are routed as-is
+							tmp_len = snprintf(tmp, 32, "%s", (mBFS > GAIN_MIN) ? "routed" : "blocked");
+						else
+							tmp_len = snprintf(tmp, 32, "%+2.2f dBFS", dBFS);
 						const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
 						const float fy = body.y + body.h + fh + fh/2;
 						const struct nk_rect body2 = {
@@ -423,9 +470,9 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 					}
 				}
 
-				if(mBFS > -3600)
+				if(is_offset || (mBFS > GAIN_MIN) ) // offsets are never disconnected
 				{
-					const float alpha = (dBFS + 36.f) / 72.f;
+					const float alpha = (dBFS + 36.f) / 72.f; // linear for CV
 					const float beta = NK_PI/2;
 
 					nk_stroke_arc(canvas,
@@ -474,8 +521,7 @@ node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 	const float ps = 24.f * app->scale;
 	const unsigned ny = shm->nsinks;
 
-	client->dim.x = 6 * ps;
-	client->dim.y = ny * ps;
+	client->dim = _client_dim(app, client);
 
 	struct nk_rect bounds = nk_rect(
 		client->pos.x - client->dim.x/2 - scrolling.x,
@@ -501,12 +547,24 @@ node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 
 		nk_fill_rect(canvas, body, style->rounding, style->hover.data.color);
 
+		// values read below are at least as recent as this
+		client->drawn.seq = atomic_load_explicit(&shm->seq, memory_order_acquire);
+		client->drawn.valid = true;
+
 		if(client->sink_type == TYPE_AUDIO)
 		{
 			for(unsigned j = 0; j < ny; j++)
 			{
-				const int32_t mBFS = atomic_load_explicit(&shm->jgains[j], memory_order_relaxed);
-				const float dBFS = mBFS / 100.f;
+				monitor_level_t *level = &shm->levels[j];
+				const bool is_lufs = (shm->mode == MONITOR_MODE_LUFS);
+				const float tp_dBFS = atomic_load_explicit(&level->true_peak, memory_order_relaxed) / 100.f;
+				const float hold_dBFS = atomic_load_explicit(&level->hold, memory_order_relaxed) / 100.f;
+				const float i_LUFS = atomic_load_explicit(&level->integrated, memory_order_relaxed) / 100.f;
+				// LUFS are drawn on the same scale as dBFS: momentary as bar, short-term as narrow bar
+				const float dBFS = atomic_load_explicit(is_lufs ? &level->momentary : &level->peak,
+					memory_order_relaxed) / 100.f;
+				const float rms_dBFS = atomic_load_explicit(is_lufs ? &level->short_term : &level->rms,
+					memory_order_relaxed) / 100.f;
 
 				struct nk_rect orig = nk_rect(body.x, body.y + j*ps, body.w, ps);
 				struct nk_rect tile = orig;
@@ -553,6 +611,70 @@ node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 					nk_fill_rect_multi_color(canvas, tile, left, top, right, bottom);
 				}
 
+				// RMS or short-term loudness as narrower bar within peak bar
+				{
+					const float rms = NK_CLAMP(0.f, (rms_dBFS + 64.f) / 70.f, 1.f);
+
+					tile = outline;
+					tile.y += tile.h/3;
+					tile.h /= 3;
+					tile.w *= rms;
+					nk_fill_rect(canvas, tile, 0.f, nk_rgba(0xff, 0xff, 0xff, alph));
+				}
+
+				// true-peak as tick, red when beyond 0dBFS
+				if(tp_dBFS > -64.f)
+				{
+					const float tp = NK_CLAMP(0.f, (tp_dBFS + 64.f) / 70.f, 1.f);
+					const float x0 = outline.x + outline.w*tp;
+					const struct nk_color col = (tp > 64.f / 70.f)
+						? nk_rgba(0xff, 0x00, 0x00, 0xff)
+						: nk_rgba(0xff, 0xff, 0xff, 0xff);
+
+					nk_stroke_line(canvas, x0, outline.y, x0, outline.y + outline.h,
+						2.f * ctx->style.window.group_border, col);
+				}
+
+				// held true-peak as thin tick
+				if(hold_dBFS > -64.f)
+				{
+					const float hold = NK_CLAMP(0.f, (hold_dBFS + 64.f) / 70.f, 1.f);
+					const float x0 = outline.x + outline.w*hold;
+
+					nk_stroke_line(canvas, x0, outline.y, x0, outline.y + outline.h,
+						ctx->style.window.group_border, nk_rgba(0xff, 0xff, 0xff, alph));
+				}
+
+				// integrated loudness as tick
+				if(is_lufs && (i_LUFS > -64.f) )
+				{
+					const float il = NK_CLAMP(0.f, (i_LUFS + 64.f) / 70.f, 1.f);
+					const float x0 = outline.x + outline.w*il;
+
+					nk_stroke_line(canvas, x0, outline.y, x0, outline.y + outline.h,
+						2.f * ctx->style.window.group_border, nk_rgba(0xff, 0x7f, 0x00, 0xff));
+				}
+
+				if(nk_input_is_mouse_hovering_rect(in, orig) && !client->moving)
+				{
+					char tmp [48];
+
+					const struct nk_user_font *font = ctx->style.font;
+					const float fh = font->height;
+					const size_t tmp_len = is_lufs
+						? snprintf(tmp, 48, "%+2.1f/%+2.1f/%+2.1f LUFS", dBFS, rms_dBFS, i_LUFS)
+						: snprintf(tmp, 48, "%+2.1f/%+2.1f dBFS", tp_dBFS, hold_dBFS);
+					const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
+					const struct nk_rect body2 = {
+						.x = body.x + (body.w - fw)/2,
+						.y = body.y + body.h + fh/2,
+						.w = fw,
+						.h = fh
+					};
+					nk_draw_text(canvas, body2, tmp, tmp_len, font,
+						style->normal.data.color, style->text_normal);
+				}
+
 				// draw 6dBFS lines from -60 to +6
 				for(unsigned i = 4; i <= 70; i += 6)
 				{
@@ -577,7 +699,7 @@ node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 		{
 			for(unsigned j = 0; j < ny; j++)
 			{
-				const int32_t cvel = atomic_load_explicit(&shm->jgains[j], memory_order_relaxed);
+				const int32_t cvel = atomic_load_explicit(&shm->levels[j].peak, memory_order_relaxed);
 				const float vel = cvel / 100.f;
 
 				struct nk_rect orig = nk_rect(body.x, body.y + j*ps, body.w, ps);
@@ -627,6 +749,93 @@ node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 				nk_stroke_rect(canvas, outline, 0.f, ctx->style.window.group_border, ctx->style.window.group_border_color);
 			}
 		}
+#ifdef JACK_HAS_METADATA_API
+		else if(client->sink_type == TYPE_CV)
+		{
+			for(unsigned j = 0; j < ny; j++)
+			{
+				monitor_level_t *level = &shm->levels[j];
+				const float min = atomic_load_explicit(&level->min, memory_order_relaxed) / (float)GAIN_UNITY_CV;
+				const float max = atomic_load_explicit(&level->max, memory_order_relaxed) / (float)GAIN_UNITY_CV;
+				const float mean = atomic_load_explicit(&level->mean, memory_order_relaxed) / (float)GAIN_UNITY_CV;
+
+				struct nk_rect orig = nk_rect(body.x, body.y + j*ps, body.w, ps);
+				struct nk_rect tile = orig;
+				struct nk_rect outline;
+				const uint8_t alph = 0x7f;
+
+				{
+					const float ox = ctx->style.font->height/2 + ctx->style.property.border + ctx->style.property.padding.x;
+					const float oy = ctx->style.property.border + ctx->style.property.padding.y;
+					tile.x += ox;
+					tile.y += oy;
+					tile.w -= 2*ox;
+					tile.h -= 2*oy;
+					outline = tile;
+				}
+
+				// range from minimum to maximum as bar, from -1 to +1
+				{
+					const float e0 = NK_CLAMP(0.f, (min + 1.f) / 2.f, 1.f);
+					const float e1 = NK_CLAMP(0.f, (max + 1.f) / 2.f, 1.f);
+
+					tile = outline;
+					tile.x += outline.w * e0;
+					tile.w = NK_MAX(outline.w * (e1 - e0), 1.f);
+					nk_fill_rect(canvas, tile, 0.f, nk_rgba(0x00, 0xff, 0xff, alph));
+				}
+
+				// mean as tick, red when out of range
+				{
+					const float e = (mean + 1.f) / 2.f;
+					const float x0 = outline.x + outline.w*NK_CLAMP(0.f, e, 1.f);
+					const struct nk_color col = ( (e < 0.f) || (e > 1.f) )
+						? nk_rgba(0xff, 0x00, 0x00, 0xff)
+						: nk_rgba(0xff, 0xff, 0xff, 0xff);
+
+					nk_stroke_line(canvas, x0, outline.y, x0, outline.y + outline.h,
+						2.f * ctx->style.window.group_border, col);
+				}
+
+				if(nk_input_is_mouse_hovering_rect(in, orig) && !client->moving)
+				{
+					char tmp [48];
+
+					const struct nk_user_font *font = ctx->style.font;
+					const float fh = font->height;
+					const size_t tmp_len = snprintf(tmp, 48, "%+1.3f/%+1.3f/%+1.3f", min, mean, max);
+					const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
+					const struct nk_rect body2 = {
+						.x = body.x + (body.w - fw)/2,
+						.y = body.y + body.h + fh/2,
+						.w = fw,
+						.h = fh
+					};
+					nk_draw_text(canvas, body2, tmp, tmp_len, font,
+						style->normal.data.color, style->text_normal);
+				}
+
+				// draw lines every 0.25
+				for(unsigned i = 0; i <= 8; i++)
+				{
+					const bool is_zero = (i == 4);
+					const float dx = outline.w * i / 8.f;
+
+					const float x0 = outline.x + dx;
+					const float y0 = is_zero ? orig.y + 2.f : outline.y;
+
+					const float border = (is_zero ? 2.f : 1.f) * ctx->style.window.group_border;
+
+					const float x1 = x0;
+					const float y1 = is_zero ? orig.y + orig.h - 2.f : outline.y + outline.h;
+
+					nk_stroke_line(canvas, x0, y0, x1, y1, border, ctx->style.window.group_border_color);
+				}
+
+				nk_stroke_rect(canvas, outline, 0.f, ctx->style.window.group_border, ctx->style.window.group_border_color);
+			}
+		}
+#endif
 
 		nk_stroke_rect(canvas, body, style->rounding, style->border,
 			is_hilighted ? hilight_color : style->border_color);
@@ -678,6 +887,222 @@ _client_num_sinks(client_t *client, port_type_t type)
 	return 0;
 }
 
+static struct nk_rect
+_client_bounds(app_t *app, client_t *client)
+{
+	const float cw = 4.f * app->scale; // connector handles stick out
+
+	return nk_rect(
+		client->pos.x - client->dim.x/2 - 4*cw,
+		client->pos.y - client->dim.y/2 - 4*cw,
+		client->dim.x + 8*cw,
+		client->dim.y + 8*cw);
+}
+
+static struct nk_rect
+_client_conn_bounds(app_t *app, client_conn_t *client_conn)
+{
+	const client_t *src = client_conn->source_client;
+	const client_t *snk = client_conn->sink_client;
+
+	const float ps = 16.f * app->scale;
+	const float cs = 4.f * app->scale;
+	const float bend = 50.f * app->scale;
+	const float pw = _client_num_sources(client_conn->source_client, app->type) * ps;
+	const float ph = _client_num_sinks(client_conn->sink_client, app->type) * ps;
+
+	const float cx = client_conn->pos.x;
+	const float cy = client_conn->pos.y;
+	const float l0x = src->pos.x + src->dim.x/2 + cs*2;
+	const float l0y = src->pos.y;
+	const float l1x = snk->mixer_shm
+		? snk->pos.x
+		: snk->pos.x - snk->dim.x/2 - cs*2;
+	const float l1y = snk->mixer_shm
+		? snk->pos.y - snk->dim.y/2 - cs*2
+		: snk->pos.y;
+
+	// matrix plus control points of both wires, which enclose the curves
+	const float x0 = NK_MIN(NK_MIN(cx - pw/2, l0x), l1x - bend);
+	const float x1 = NK_MAX(NK_MAX(cx + pw/2 + bend, l0x + bend), l1x);
+	const float y0 = NK_MIN(NK_MIN(cy - ph/2 - bend, l0y), l1y - bend);
+	const float y1 = NK_MAX(NK_MAX(cy + ph/2, l0y), l1y);
+
+	return nk_rect(x0 - cs, y0 - cs, x1 - x0 + 2*cs, y1 - y0 + 2*cs);
+}
+
+static unsigned
+_spatial_bucket(int cx, int cy)
+{
+	return ((unsigned)cx*73856093U ^ (unsigned)cy*19349663U) % SPATIAL_BUCKETS;
+}
+
+static uint64_t
+_spatial_mask(struct nk_rect bounds)
+{
+	const int cx0 = floorf(bounds.x / SPATIAL_CELL);
+	const int cy0 = floorf(bounds.y / SPATIAL_CELL);
+	const int cx1 = floorf((bounds.x + bounds.w) / SPATIAL_CELL);
+	const int cy1 = floorf((bounds.y + bounds.h) / SPATIAL_CELL);
+
+	// covers more cells than there are buckets
+	if(  (cx1 - cx0 >= SPATIAL_BUCKETS) || (cy1 - cy0 >= SPATIAL_BUCKETS)
+		|| ((cx1 - cx0 + 1) * (cy1 - cy0 + 1) >= SPATIAL_BUCKETS) )
+	{
+		return UINT64_MAX;
+	}
+
+	uint64_t mask = 0;
+
+	for(int cy = cy0; cy <= cy1; cy++)
+	{
+		for(int cx = cx0; cx <= cx1; cx++)
+			mask |= UINT64_C(1) << _spatial_bucket(cx, cy);
+	}
+
+	return mask;
+}
+
+static bool
+_spatial_overlap(struct nk_rect a, struct nk_rect b)
+{
+	return (a.x < b.x + b.w) && (b.x < a.x + a.w)
+		&& (a.y < b.y + b.h) && (b.y < a.y + a.h);
+}
+
+static void
+_spatial_update(app_t *app)
+{
+	spatial_t *spatial = &app->spatial;
+
+	if(!spatial->dirty)
+		return;
+
+	const unsigned size = _hash_size(&app->clients) + _hash_size(&app->conns);
+	if(size > spatial->capacity)
+	{
+		spatial_node_t *nodes = realloc(spatial->nodes, size*sizeof(spatial_node_t));
+		if(!nodes)
+			return;
+
+		spatial->nodes = nodes;
+		spatial->capacity = size;
+	}
+
+	spatial_node_t *node = spatial->nodes;
+
+	// clients first, connection bounds depend on their dimensions
+	HASH_FOREACH(&app->clients, client_itr)
+	{
+		client_t *client = *client_itr;
+
+		client->dim = _client_dim(app, client);
+
+		node->bounds = _client_bounds(app, client);
+		node->client = client;
+		node->client_conn = NULL;
+		node->stamp = 0;
+		node++;
+	}
+
+	HASH_FOREACH(&app->conns, client_conn_itr)
+	{
+		client_conn_t *client_conn = *client_conn_itr;
+
+		node->bounds = _client_conn_bounds(app, client_conn);
+		node->client = NULL;
+		node->client_conn = client_conn;
+		node->stamp = 0;
+		node++;
+	}
+
+	spatial->size = size;
+
+	for(unsigned b = 0; b < SPATIAL_BUCKETS; b++)
+		_hash_clear(&spatial->buckets[b]);
+	_hash_clear(&spatial->pinned);
+
+	for(unsigned n = 0; n < spatial->size; n++)
+	{
+		node = &spatial->nodes[n];
+
+		const uint64_t mask = _spatial_mask(node->bounds);
+
+		for(unsigned b = 0; b < SPATIAL_BUCKETS; b++)
+		{
+			if(mask & (UINT64_C(1) << b))
+				_hash_add(&spatial->buckets[b], node);
+		}
+
+		if(  (node->client && node->client->moving)
+			|| (node->client_conn && node->client_conn->moving) )
+		{
+			_hash_add(&spatial->pinned, node);
+		}
+	}
+
+	spatial->dirty = false;
+}
+
+static int
+_spatial_node_cmp(const void *a, const void *b)
+{
+	const spatial_node_t *node_a = *(const spatial_node_t **)a;
+	const spatial_node_t *node_b = *(const spatial_node_t **)b;
+
+	return (node_a > node_b) - (node_a < node_b); // drawing order
+}
+
+static void
+_spatial_query(app_t *app, struct nk_rect view)
+{
+	spatial_t *spatial = &app->spatial;
+	const uint64_t mask = _spatial_mask(view);
+
+	_hash_clear(&spatial->result);
+
+	if(++spatial->stamp == 0) // never match freshly built nodes
+		spatial->stamp = 1;
+
+	for(unsigned b = 0; b < SPATIAL_BUCKETS; b++)
+	{
+		if(!(mask & (UINT64_C(1) << b)))
+			continue;
+
+		HASH_FOREACH(&spatial->buckets[b], node_itr)
+		{
+			spatial_node_t *node = *node_itr;
+
+			if(node->stamp == spatial->stamp) // spans several cells
+				continue;
+
+			if(_spatial_overlap(node->bounds, view))
+			{
+				node->stamp = spatial->stamp;
+				_hash_add(&spatial->result, node);
+			}
+		}
+	}
+
+	// keep dragged nodes alive even when moved out of view
+	HASH_FOREACH(&spatial->pinned, node_itr)
+	{
+		spatial_node_t *node = *node_itr;
+
+		if(node->stamp == spatial->stamp)
+			continue;
+
+		if(  (node->client && node->client->moving)
+			|| (node->client_conn && node->client_conn->moving) )
+		{
+			node->stamp = spatial->stamp;
+			_hash_add(&spatial->result, node);
+		}
+	}
+
+	_hash_sort(&spatial->result, _spatial_node_cmp);
+}
+
 static void
 node_editor_client(struct nk_context *ctx, app_t *app, client_t *client)
 {
@@ -689,8 +1114,7 @@ node_editor_client(struct nk_context *ctx, app_t *app, client_t *client)
 	struct nk_command_buffer *canvas = nk_window_get_canvas(ctx);
 	const struct nk_vec2 scrolling = nodedit->scrolling;
 
-	client->dim.x = 200.f * app->scale;
-	client->dim.y = app->dy;
+	client->dim = _client_dim(app, client);
 
 	struct nk_rect bounds = nk_rect(
 		client->pos.x - client->dim.x/2 - scrolling.x,
@@ -847,6 +1271,7 @@ node_editor_client_conn(struct nk_context *ctx, app_t *app,
 			client_conn->pos.y += in->mouse.delta.y;
 			bounds.x += in->mouse.delta.x;
 			bounds.y += in->mouse.delta.y;
+			app->spatial.dirty = true;
 		}
 	}
 	else if(is_hovering
@@ -970,9 +1395,9 @@ node_editor_client_conn(struct nk_context *ctx, app_t *app,
 				if(!(sink_port->type & port_type))
 					continue;
 
-				port_conn_t *port_conn = _port_conn_find(client_conn, source_port, sink_port);
+				const bool is_connected = _client_conn_test(client_conn, source_port, sink_port);
 
-				if(port_conn)
+				if(is_connected)
 				{
 					const bool is_automation = !strcmp(sink_port->short_name, "automation");
 
@@ -1027,7 +1452,7 @@ node_editor_client_conn(struct nk_context *ctx, app_t *app,
 
 					if(nk_input_is_mouse_pressed(in, NK_BUTTON_LEFT) || (dd != 0.f) )
 					{
-						if(port_conn)
+						if(is_connected)
 							jack_disconnect(app->client, source_port->name, sink_port->name);
 						else
 							jack_connect(app->client, source_port->name, sink_port->name);
@@ -1059,6 +1484,8 @@ _expose(struct nk_context *ctx, struct nk_rect wbounds, void *data)
 	{
 		struct nk_command_buffer *canvas = nk_window_get_canvas(ctx);
 
+		const port_type_t type = app->type;
+
 		nk_menubar_begin(ctx);
 		{
 			struct nk_style_button *style = &ctx->style.button;
@@ -1104,6 +1531,9 @@ _expose(struct nk_context *ctx, struct nk_rect wbounds, void *data)
 		}
 		nk_menubar_end(ctx);
 
+		if(app->type != type) // matrix dimensions depend on type
+			app->spatial.dirty = true;
+
 		struct nk_rect total_space = nk_window_get_content_region(ctx);
 		total_space.h -= app->dy + 2*ctx->style.window.group_padding.y;
 
@@ -1150,10 +1580,35 @@ _expose(struct nk_context *ctx, struct nk_rect wbounds, void *data)
 				}
 			}
 
-			HASH_FOREACH(&app->clients, client_itr)
+			// reset per-frame state of clients drawn in last frame
+			HASH_FOREACH(&app->spatial.visible, client_itr)
 			{
 				client_t *client = *client_itr;
 
+				client->hovered = false;
+				client->drawn.valid = false; // only what gets drawn can be damaged
+			}
+			_hash_clear(&app->spatial.visible);
+
+			// only visit nodes intersecting the scrolled view
+			const struct nk_rect view = nk_rect(
+				space_bounds.x + scrolling.x,
+				space_bounds.y + scrolling.y,
+				space_bounds.w, space_bounds.h);
+
+			_spatial_update(app);
+			_spatial_query(app, view);
+
+			HASH_FOREACH(&app->spatial.result, node_itr)
+			{
+				spatial_node_t *node = *node_itr;
+				client_t *client = node->client;
+
+				if(!client)
+					continue;
+
+				_hash_add(&app->spatial.visible, client);
+
 				if(client->mixer_shm)
 					node_editor_mixer(ctx, app, client);
 				else if(client->monitor_shm)
@@ -1164,9 +1619,13 @@ _expose(struct nk_context *ctx, struct nk_rect wbounds, void *data)
 				client->hilighted = false;
 			}
 
-			HASH_FOREACH(&app->conns, client_conn_itr)
+			HASH_FOREACH(&app->spatial.result, node_itr)
 			{
-				client_conn_t *client_conn = *client_conn_itr;
+				spatial_node_t *node = *node_itr;
+				client_conn_t *client_conn = node->client_conn;
+
+				if(!client_conn)
+					continue;
 
 				node_editor_client_conn(ctx, app, client_conn, app->type);
 			}
@@ -1179,12 +1638,14 @@ _expose(struct nk_context *ctx, struct nk_rect wbounds, void *data)
 			}
 
 			// contextual menu
-			if(
+			if(nk_contextual_begin(ctx, 0, nk_vec2(100, 480), total_space))
+			{
 #ifdef JACK_HAS_METADATA_API
-				(app->type != TYPE_OSC) && (app->type != TYPE_CV) &&
+				const bool has_monitor = (app->type != TYPE_OSC); // OSC is routed only
+#else
+				const bool has_monitor = true;
 #endif
-				nk_contextual_begin(ctx, 0, nk_vec2(100, 360), total_space))
-			{
+
 				nk_layout_row_dynamic(ctx, app->dy, 1);
 				if(nk_contextual_item_label(ctx, "Mixer 1x1", NK_TEXT_LEFT))
 					_mixer_spawn(app, 1, 1);
@@ -1194,14 +1655,26 @@ _expose(struct nk_context *ctx, struct nk_rect wbounds, void *data)
 					_mixer_spawn(app, 4, 4);
 				if(nk_contextual_item_label(ctx, "Mixer 8x8", NK_TEXT_LEFT))
 					_mixer_spawn(app, 8, 8);
-				if(nk_contextual_item_label(ctx, "Monitor x1", NK_TEXT_LEFT))
-					_monitor_spawn(app, 1);
-				if(nk_contextual_item_label(ctx, "Monitor x2", NK_TEXT_LEFT))
-					_monitor_spawn(app, 2);
-				if(nk_contextual_item_label(ctx, "Monitor x4", NK_TEXT_LEFT))
-					_monitor_spawn(app, 4);
-				if(nk_contextual_item_label(ctx, "Monitor x8", NK_TEXT_LEFT))
-					_monitor_spawn(app, 8);
+				if(has_monitor)
+				{
+					if(nk_contextual_item_label(ctx, "Monitor x1", NK_TEXT_LEFT))
+						_monitor_spawn(app, 1, MONITOR_MODE_PEAK);
+					if(nk_contextual_item_label(ctx, "Monitor x2", NK_TEXT_LEFT))
+						_monitor_spawn(app, 2, MONITOR_MODE_PEAK);
+					if(nk_contextual_item_label(ctx, "Monitor x4", NK_TEXT_LEFT))
+						_monitor_spawn(app, 4, MONITOR_MODE_PEAK);
+					if(nk_contextual_item_label(ctx, "Monitor x8", NK_TEXT_LEFT))
+						_monitor_spawn(app, 8, MONITOR_MODE_PEAK);
+				}
+				if(app->type == TYPE_AUDIO)
+				{
+					if(nk_contextual_item_label(ctx, "PPM x2", NK_TEXT_LEFT))
+						_monitor_spawn(app, 2, MONITOR_MODE_PPM);
+					if(nk_contextual_item_label(ctx, "Loudness x1", NK_TEXT_LEFT))
+						_monitor_spawn(app, 1, MONITOR_MODE_LUFS);
+					if(nk_contextual_item_label(ctx, "Loudness x2", NK_TEXT_LEFT))
+						_monitor_spawn(app, 2, MONITOR_MODE_LUFS);
+				}
 
 				nk_contextual_end(ctx);
 			}
@@ -1368,3 +1841,29 @@ _ui_signal(app_t *app)
 	if(!atomic_load_explicit(&app->done, memory_order_acquire))
 		nk_pugl_async_redisplay(&app->win);
 }
+
+bool
+_ui_damaged(app_t *app)
+{
+	// only animated nodes can change without an accompanying event
+	HASH_FOREACH(&app->spatial.visible, client_itr)
+	{
+		client_t *client = *client_itr;
+
+		if(!client->drawn.valid)
+			continue;
+
+		if(client->mixer_shm)
+		{
+			if(atomic_load_explicit(&client->mixer_shm->seq, memory_order_relaxed) != client->drawn.seq)
+				return true;
+		}
+		else if(client->monitor_shm)
+		{
+			if(atomic_load_explicit(&client->monitor_shm->seq, memory_order_relaxed) != client->drawn.seq)
+				return true;
+		}
+	}
+
+	return false;
+}